@@ -3,9 +3,7 @@
 //
 
 #include "BlurManager.h"
-#include "stackblur/abgr-stackblur.h"
 #include <jni.h>
-#include <android/bitmap.h>
 #include <android/native_window.h>
 #include <android/hardware_buffer.h>
 #include <android/hardware_buffer_jni.h>
@@ -14,25 +12,41 @@
 #include <android/surface_texture_jni.h>
 
 static ABGRStackBlur *stackBlur = new ABGRStackBlur();
+static RGBStackBlur *rgbStackBlur = new RGBStackBlur();
+static BlurOptions blurOptions;
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_io_github_pknujsp_blur_natives_NativeImageProcessorImpl_prepareBlur(JNIEnv *env, jobject thiz, jint width, jint height, jint radius,
-                                                                         jdouble resize_ratio) {
-    stackBlur->prepare(width, height, radius, resize_ratio);
+                                                                         jdouble resize_ratio, jboolean blur_alpha) {
+    blurOptions = BlurOptions{radius, resize_ratio, blur_alpha ? AlphaMode::PREMULTIPLIED : AlphaMode::OPAQUE};
+    stackBlur->prepare(width, height, radius, resize_ratio, blurOptions.alphaMode);
+    // Prepared by the first RGB_565 bitmap, most callers never use both formats.
+    rgbStackBlur->onDestroy();
 }
 
 extern "C"
 JNIEXPORT jobject JNICALL
 Java_io_github_pknujsp_blur_natives_NativeImageProcessorImpl_blur(JNIEnv *env, jobject thiz, jobject src_bitmap) {
+    AndroidBitmapInfo info;
+    if (AndroidBitmap_getInfo(env, src_bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS) return nullptr;
+
     void *pixels;
-    AndroidBitmap_lockPixels(env, src_bitmap, &pixels);
-    stackBlur->blur((unsigned int *) pixels);
+    if (AndroidBitmap_lockPixels(env, src_bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS) return nullptr;
+
+    bool blurred = false;
+    if (info.format == ANDROID_BITMAP_FORMAT_RGBA_8888) {
+        blurred = blurBitmapPixels(stackBlur, blurOptions, pixels, info);
+    } else if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
+        blurred = blurBitmapPixels(rgbStackBlur, blurOptions, pixels, info);
+    }
+
     AndroidBitmap_unlockPixels(env, src_bitmap);
-    return src_bitmap;
+    return blurred ? src_bitmap : nullptr;
 }
 extern "C"
 JNIEXPORT void JNICALL
 Java_io_github_pknujsp_blur_natives_NativeImageProcessorImpl_onClear(JNIEnv *env, jobject thiz) {
     stackBlur->onDestroy();
+    rgbStackBlur->onDestroy();
 }
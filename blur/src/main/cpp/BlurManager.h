@@ -5,4 +5,35 @@
 #ifndef TESTBED_BLURMANAGER_H
 #define TESTBED_BLURMANAGER_H
 
+#include <android/bitmap.h>
+#include "stackblur/abgr-stackblur.h"
+#include "stackblur/rgb-stackblur.h"
+
+// Arguments of the last prepareBlur call, kept so that the engine matching a bitmap's format can be
+// prepared when the first bitmap of that format arrives.
+struct BlurOptions {
+    int radius = 0;
+    double resizeRatio = 1.0;
+    AlphaMode alphaMode = AlphaMode::OPAQUE;
+};
+
+/**
+ * Blurs the locked pixels of a bitmap in place with the engine for its format, preparing the engine
+ * first if it was prepared for another size. The rows may be padded. Returns false when the stride
+ * is not a whole number of pixels.
+ */
+template<typename T>
+inline bool blurBitmapPixels(Blur<T> *engine, const BlurOptions &options, void *pixels, const AndroidBitmapInfo &info) {
+    if (info.stride % sizeof(T) != 0 or info.stride < info.width * sizeof(T)) return false;
+
+    const int width = (int) info.width;
+    const int height = (int) info.height;
+    if (not engine->isPreparedFor(width, height)) {
+        engine->prepare(width, height, options.radius, options.resizeRatio, options.alphaMode);
+    }
+
+    engine->blur((T *) pixels, (int) (info.stride / sizeof(T)));
+    return true;
+}
+
 #endif //TESTBED_BLURMANAGER_H
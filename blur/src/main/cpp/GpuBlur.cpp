@@ -0,0 +1,220 @@
+#include "GpuBlur.h"
+#include <algorithm>
+#include <cmath>
+#include <android/log.h>
+
+#define LOG_TAG "GpuBlur"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+// One triangle that covers the viewport, with no vertex buffer.
+static const char *vertexShaderCode = R"(#version 300 es
+    out highp vec2 v_texCoord;
+    void main() {
+      vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+      v_texCoord = position;
+      gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+    }
+)";
+
+// Both passes compute the coordinates at highp. At mediump, which is fp16 on most mobile GPUs, half
+// a texel of a 1080 pixel source is about the spacing of the values in [0.5, 1), and the taps would
+// snap onto each other. The colour sums stay mediump.
+static const char *downFragmentShaderCode = R"(#version 300 es
+    precision highp float;
+    in highp vec2 v_texCoord;
+    uniform mediump sampler2D s_texture;
+    uniform highp vec2 u_halfPixel;
+    uniform highp float u_offset;
+    out mediump vec4 fragColor;
+    void main() {
+      highp vec2 d = u_halfPixel * u_offset;
+      mediump vec4 sum = texture(s_texture, v_texCoord) * 4.0;
+      sum += texture(s_texture, v_texCoord - d);
+      sum += texture(s_texture, v_texCoord + d);
+      sum += texture(s_texture, v_texCoord + vec2(d.x, -d.y));
+      sum += texture(s_texture, v_texCoord - vec2(d.x, -d.y));
+      fragColor = sum / 8.0;
+    }
+)";
+
+static const char *upFragmentShaderCode = R"(#version 300 es
+    precision highp float;
+    in highp vec2 v_texCoord;
+    uniform mediump sampler2D s_texture;
+    uniform highp vec2 u_halfPixel;
+    uniform highp float u_offset;
+    out mediump vec4 fragColor;
+    void main() {
+      highp vec2 d = u_halfPixel * u_offset;
+      mediump vec4 sum = texture(s_texture, v_texCoord + vec2(-d.x * 2.0, 0.0));
+      sum += texture(s_texture, v_texCoord + vec2(-d.x, d.y)) * 2.0;
+      sum += texture(s_texture, v_texCoord + vec2(0.0, d.y * 2.0));
+      sum += texture(s_texture, v_texCoord + vec2(d.x, d.y)) * 2.0;
+      sum += texture(s_texture, v_texCoord + vec2(d.x * 2.0, 0.0));
+      sum += texture(s_texture, v_texCoord + vec2(d.x, -d.y)) * 2.0;
+      sum += texture(s_texture, v_texCoord + vec2(0.0, -d.y * 2.0));
+      sum += texture(s_texture, v_texCoord + vec2(-d.x, -d.y)) * 2.0;
+      fragColor = sum / 12.0;
+    }
+)";
+
+static GLuint compileShader(GLenum type, const char *shaderCode) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &shaderCode, nullptr);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled == GL_FALSE) {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        LOGD("Shader compilation failed: %s", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool GpuBlur::createPass(Pass &pass, const char *fragmentShaderCode) {
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderCode);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderCode);
+    if (vertexShader == 0 or fragmentShader == 0) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return false;
+    }
+
+    pass.program = glCreateProgram();
+    glAttachShader(pass.program, vertexShader);
+    glAttachShader(pass.program, fragmentShader);
+    glLinkProgram(pass.program);
+    // Flagged for deletion, they go away with the program.
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(pass.program, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE) {
+        LOGD("Program link failed");
+        return false;
+    }
+    pass.textureHandle = glGetUniformLocation(pass.program, "s_texture");
+    pass.halfPixelHandle = glGetUniformLocation(pass.program, "u_halfPixel");
+    pass.offsetHandle = glGetUniformLocation(pass.program, "u_offset");
+    return true;
+}
+
+bool GpuBlur::prepare(int width, int height, int radius, double resizeRatio) {
+    release();
+    if (width <= 0 or height <= 0) return false;
+
+    if (not createPass(downPass, downFragmentShaderCode) or not createPass(upPass, upFragmentShaderCode)) {
+        release();
+        return false;
+    }
+
+    // Each iteration about doubles the reach of the filter; the offset spreads the taps for the
+    // radii in between. This approximates a gaussian of the given radius, not exactly the StackBlur.
+    radius = std::max(radius, 1);
+    iterations = 1;
+    while (iterations < kMaxIterations and (2 << iterations) < radius) iterations++;
+    offset = std::max(1.0f, (float) radius / (float) (1 << iterations));
+
+    const double ratio = std::max(resizeRatio, 1.0);
+    const auto baseWidth = (GLsizei) std::max(1.0, std::round(width / ratio));
+    const auto baseHeight = (GLsizei) std::max(1.0, std::round(height / ratio));
+    // Don't halve below a pixel, the last levels would only repeat the same one.
+    while (iterations > 1 and (std::min(baseWidth, baseHeight) >> iterations) < 1) iterations--;
+
+    for (int i = 0; i <= iterations; i++) {
+        Level &level = levels[i];
+        level.width = std::max(1, baseWidth >> i);
+        level.height = std::max(1, baseHeight >> i);
+
+        glGenTextures(1, &level.texture);
+        glBindTexture(GL_TEXTURE_2D, level.texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, level.width, level.height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenFramebuffers(1, &level.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, level.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, level.texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            LOGD("Framebuffer %d of %dx%d is incomplete", i, level.width, level.height);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            release();
+            return false;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // The passes have no vertex attributes, an empty vertex array keeps those of the caller's
+    // default one out of the way.
+    glGenVertexArrays(1, &vertexArray);
+
+    sourceWidth = width;
+    sourceHeight = height;
+    prepared = glGetError() == GL_NO_ERROR;
+    if (not prepared) release();
+    return prepared;
+}
+
+void GpuBlur::run(const Pass &pass, GLuint source, GLsizei width, GLsizei height, float tapOffset, const Level &target) const {
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glViewport(0, 0, target.width, target.height);
+    glUseProgram(pass.program);
+    glBindTexture(GL_TEXTURE_2D, source);
+    glUniform1i(pass.textureHandle, 0);
+    glUniform2f(pass.halfPixelHandle, 0.5f / (float) width, 0.5f / (float) height);
+    glUniform1f(pass.offsetHandle, tapOffset);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+GLuint GpuBlur::blur(GLuint sourceTexture) {
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(vertexArray);
+    glDisable(GL_BLEND);
+
+    // A resized source is first scaled into level 0, with taps half a texel of level 0 apart so
+    // that they spread over the source texels each of its texels covers. Halving it straight into
+    // level 1 would skip most of them, and shimmer while scrolling.
+    GLuint firstTexture = sourceTexture;
+    if (levels[0].width != sourceWidth or levels[0].height != sourceHeight) {
+        run(downPass, sourceTexture, levels[0].width, levels[0].height, 1.0f, levels[0]);
+        firstTexture = levels[0].texture;
+    }
+    run(downPass, firstTexture, levels[0].width, levels[0].height, offset, levels[1]);
+    for (int i = 1; i < iterations; i++) {
+        run(downPass, levels[i].texture, levels[i].width, levels[i].height, offset, levels[i + 1]);
+    }
+    for (int i = iterations; i > 0; i--) {
+        run(upPass, levels[i].texture, levels[i].width, levels[i].height, offset, levels[i - 1]);
+    }
+
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return levels[0].texture;
+}
+
+void GpuBlur::release() {
+    for (Level &level: levels) {
+        if (level.framebuffer != 0) glDeleteFramebuffers(1, &level.framebuffer);
+        if (level.texture != 0) glDeleteTextures(1, &level.texture);
+    }
+    if (downPass.program != 0) glDeleteProgram(downPass.program);
+    if (upPass.program != 0) glDeleteProgram(upPass.program);
+    if (vertexArray != 0) glDeleteVertexArrays(1, &vertexArray);
+    forget();
+}
+
+void GpuBlur::forget() {
+    for (Level &level: levels) level = Level{};
+    downPass = Pass{};
+    upPass = Pass{};
+    vertexArray = 0;
+    iterations = 0;
+    prepared = false;
+}
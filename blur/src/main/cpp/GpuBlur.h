@@ -0,0 +1,83 @@
+#ifndef TESTBED_GPUBLUR_H
+#define TESTBED_GPUBLUR_H
+
+#include <GLES3/gl32.h>
+
+/**
+ * Blurs a texture on the GPU with the dual Kawase filter: a chain of passes that each halve the
+ * image while averaging 5 taps, followed by as many passes that double it back while averaging 8.
+ * Every pass renders into a framebuffer object of the chain, so the CPU only records draw calls.
+ *
+ * The radius picks the number of halvings and the spread of the taps, and the resize ratio scales
+ * the image down into the first level of the chain before them, as the resizeRatio of the
+ * StackBlur engines does.
+ *
+ * All methods must be called on the thread of the GL context the engine was prepared on.
+ */
+class GpuBlur {
+public:
+    static constexpr int kMaxIterations = 6;
+
+    /**
+     * Compiles the programs and allocates the chain for a width x height source. Returns false if
+     * the context can't run them, e.g. a framebuffer is incomplete, in which case the caller should
+     * keep blurring on the CPU.
+     */
+    bool prepare(int width, int height, int radius, double resizeRatio);
+
+    /**
+     * Blurs the source texture, of the size given to prepare(), and returns the texture holding the
+     * result. Its size is the source size divided by the resize ratio, to be sampled with linear
+     * filtering. Leaves framebuffer 0 bound; the caller restores its program and viewport.
+     */
+    GLuint blur(GLuint sourceTexture);
+
+    bool isPrepared() const { return prepared; }
+
+    /**
+     * Deletes the GL objects. Must be called while the context is still current, and is not
+     * needed if the context was lost, as the objects went with it.
+     */
+    void release();
+
+    /**
+     * Forgets the GL objects without deleting them, after the context that owned them was lost.
+     */
+    void forget();
+
+private:
+    struct Level {
+        GLuint texture = 0;
+        GLuint framebuffer = 0;
+        GLsizei width = 0;
+        GLsizei height = 0;
+    };
+
+    struct Pass {
+        GLuint program = 0;
+        GLint textureHandle = -1;
+        GLint halfPixelHandle = -1;
+        GLint offsetHandle = -1;
+    };
+
+    bool prepared = false;
+    Pass downPass;
+    Pass upPass;
+    // Level 0 is the source scaled by the resize ratio, level i + 1 is half of level i.
+    Level levels[kMaxIterations + 1];
+    GLsizei sourceWidth = 0;
+    GLsizei sourceHeight = 0;
+    int iterations = 0;
+    float offset = 1.0f;
+    GLuint vertexArray = 0;
+
+    bool createPass(Pass &pass, const char *fragmentShaderCode);
+
+    /**
+     * Renders a pass from source into target. width x height sets the spacing of the taps, half a
+     * texel of that size times tapOffset.
+     */
+    void run(const Pass &pass, GLuint source, GLsizei width, GLsizei height, float tapOffset, const Level &target) const;
+};
+
+#endif //TESTBED_GPUBLUR_H
@@ -0,0 +1,141 @@
+#include "HardwareBuffers.h"
+#include <cstring>
+#include <dlfcn.h>
+#include <android/log.h>
+
+#define LOG_TAG "HardwareBuffers"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+const HardwareBufferApi *HardwareBufferApi::get() {
+    // Function-local static: loaded once, thread-safe, and the library is never closed.
+    static const HardwareBufferApi *api = [] () -> const HardwareBufferApi * {
+        void *library = dlopen("libnativewindow.so", RTLD_NOW bitor RTLD_LOCAL);
+        if (library == nullptr) return nullptr;
+
+        static HardwareBufferApi loaded;
+        loaded.allocate = (decltype(loaded.allocate)) dlsym(library, "AHardwareBuffer_allocate");
+        loaded.acquire = (decltype(loaded.acquire)) dlsym(library, "AHardwareBuffer_acquire");
+        loaded.release = (decltype(loaded.release)) dlsym(library, "AHardwareBuffer_release");
+        loaded.describe = (decltype(loaded.describe)) dlsym(library, "AHardwareBuffer_describe");
+        loaded.lock = (decltype(loaded.lock)) dlsym(library, "AHardwareBuffer_lock");
+        loaded.unlock = (decltype(loaded.unlock)) dlsym(library, "AHardwareBuffer_unlock");
+        if (loaded.allocate == nullptr or loaded.acquire == nullptr or loaded.release == nullptr or loaded.describe == nullptr
+            or loaded.lock == nullptr or loaded.unlock == nullptr) {
+            return nullptr;
+        }
+        return &loaded;
+    }();
+    return api;
+}
+
+// Whether the space separated list has the name, and not only a longer name starting with it.
+static bool hasExtension(const char *extensions, const char *name) {
+    if (extensions == nullptr) return false;
+    const size_t length = strlen(name);
+    for (const char *found = strstr(extensions, name); found != nullptr; found = strstr(found + length, name)) {
+        if ((found == extensions or found[-1] == ' ') and (found[length] == ' ' or found[length] == '\0')) return true;
+    }
+    return false;
+}
+
+bool HardwareBufferTextures::prepare() {
+    release();
+
+    display = eglGetCurrentDisplay();
+    if (display == EGL_NO_DISPLAY) return false;
+    const char *eglExtensions = eglQueryString(display, EGL_EXTENSIONS);
+    const char *glExtensions = (const char *) glGetString(GL_EXTENSIONS);
+    if (not hasExtension(eglExtensions, "EGL_ANDROID_get_native_client_buffer")
+        or not hasExtension(eglExtensions, "EGL_ANDROID_image_native_buffer")
+        or not hasExtension(eglExtensions, "EGL_KHR_image_base")
+        or not hasExtension(eglExtensions, "EGL_ANDROID_native_fence_sync")
+        or not hasExtension(glExtensions, "GL_OES_EGL_image")) {
+        LOGD("EGLImages of hardware buffers are not supported");
+        return false;
+    }
+
+    getNativeClientBuffer = (PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC) eglGetProcAddress("eglGetNativeClientBufferANDROID");
+    createImage = (PFNEGLCREATEIMAGEKHRPROC) eglGetProcAddress("eglCreateImageKHR");
+    destroyImage = (PFNEGLDESTROYIMAGEKHRPROC) eglGetProcAddress("eglDestroyImageKHR");
+    imageTargetTexture = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC) eglGetProcAddress("glEGLImageTargetTexture2DOES");
+    createSync = (PFNEGLCREATESYNCKHRPROC) eglGetProcAddress("eglCreateSyncKHR");
+    destroySync = (PFNEGLDESTROYSYNCKHRPROC) eglGetProcAddress("eglDestroySyncKHR");
+    dupNativeFenceFd = (PFNEGLDUPNATIVEFENCEFDANDROIDPROC) eglGetProcAddress("eglDupNativeFenceFDANDROID");
+    prepared = getNativeClientBuffer != nullptr and createImage != nullptr and destroyImage != nullptr and imageTargetTexture != nullptr
+               and createSync != nullptr and destroySync != nullptr and dupNativeFenceFd != nullptr;
+    return prepared;
+}
+
+GLuint HardwareBufferTextures::textureOf(AHardwareBuffer *buffer) {
+    for (const Entry &entry: entries) {
+        if (entry.buffer == buffer) return entry.texture;
+    }
+
+    Entry &entry = entries[nextEntry];
+    nextEntry = (nextEntry + 1) % kCacheSize;
+    releaseEntry(entry);
+
+    const EGLint attributes[] = {EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE};
+    EGLImageKHR image = createImage(display, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID, getNativeClientBuffer(buffer), attributes);
+    if (image == EGL_NO_IMAGE_KHR) {
+        LOGD("eglCreateImageKHR failed: %x", eglGetError());
+        return 0;
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // RGBA and RGB565 buffers can be sampled as a 2D texture, the programs need no external sampler.
+    imageTargetTexture(GL_TEXTURE_2D, (GLeglImageOES) image);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    const GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        LOGD("glEGLImageTargetTexture2DOES failed: %d", error);
+        glDeleteTextures(1, &texture);
+        destroyImage(display, image);
+        return 0;
+    }
+
+    HardwareBufferApi::get()->acquire(buffer);
+    entry = Entry{buffer, image, texture};
+    return texture;
+}
+
+int HardwareBufferTextures::createFence() const {
+    EGLSyncKHR sync = createSync(display, EGL_SYNC_NATIVE_FENCE_ANDROID, nullptr);
+    if (sync != EGL_NO_SYNC_KHR) {
+        // The fence only gets its fd once the commands before it are flushed.
+        glFlush();
+        const int fence = dupNativeFenceFd(display, sync);
+        destroySync(display, sync);
+        if (fence != EGL_NO_NATIVE_FENCE_FD_ANDROID) return fence;
+    }
+    glFinish();
+    return -1;
+}
+
+void HardwareBufferTextures::releaseEntry(Entry &entry) {
+    if (entry.texture != 0) glDeleteTextures(1, &entry.texture);
+    if (entry.image != EGL_NO_IMAGE_KHR) destroyImage(display, entry.image);
+    if (entry.buffer != nullptr) HardwareBufferApi::get()->release(entry.buffer);
+    entry = Entry{};
+}
+
+void HardwareBufferTextures::release() {
+    for (Entry &entry: entries) releaseEntry(entry);
+    prepared = false;
+}
+
+void HardwareBufferTextures::forget() {
+    // The textures and images went with the context and its display, the references to the buffers
+    // are still ours.
+    for (Entry &entry: entries) {
+        if (entry.buffer != nullptr) HardwareBufferApi::get()->release(entry.buffer);
+        entry = Entry{};
+    }
+    nextEntry = 0;
+    prepared = false;
+}
@@ -0,0 +1,97 @@
+#ifndef TESTBED_HARDWAREBUFFERS_H
+#define TESTBED_HARDWAREBUFFERS_H
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl32.h>
+#include <GLES2/gl2ext.h>
+#include <android/hardware_buffer.h>
+
+/**
+ * The AHardwareBuffer functions, looked up in libnativewindow at run time because the library also
+ * loads on API levels before 26, which don't have them.
+ */
+struct HardwareBufferApi {
+    int (*allocate)(const AHardwareBuffer_Desc *desc, AHardwareBuffer **outBuffer) = nullptr;
+    void (*acquire)(AHardwareBuffer *buffer) = nullptr;
+    void (*release)(AHardwareBuffer *buffer) = nullptr;
+    void (*describe)(const AHardwareBuffer *buffer, AHardwareBuffer_Desc *outDesc) = nullptr;
+    // Waits for the fence, if not -1, and closes it.
+    int (*lock)(AHardwareBuffer *buffer, uint64_t usage, int32_t fence, const ARect *rect, void **outVirtualAddress) = nullptr;
+    int (*unlock)(AHardwareBuffer *buffer, int32_t *fence) = nullptr;
+
+    /**
+     * Returns the functions, loaded on the first call, or nullptr if the device doesn't have them.
+     */
+    static const HardwareBufferApi *get();
+};
+
+/**
+ * Samples AHardwareBuffers as GL_TEXTURE_2D textures through EGLImages, so that the frames the CPU
+ * wrote into them are drawn where they are, without being copied into a texture first.
+ *
+ * The GPU reads the buffers asynchronously. Before the CPU writes into a buffer again, it must wait
+ * for a fence of createFence() issued after the last draw that sampled it.
+ *
+ * All methods must be called on the thread of the GL context the textures were prepared on.
+ */
+class HardwareBufferTextures {
+public:
+    /**
+     * Looks up the EGL and GL extensions in the current context. Returns false if one is missing,
+     * in which case the frames have to be uploaded as before.
+     */
+    bool prepare();
+
+    bool isPrepared() const { return prepared; }
+
+    /**
+     * Returns the texture sampling the buffer, created on the first call for it and kept for a few
+     * buffers. Returns 0 if the buffer can't be sampled.
+     */
+    GLuint textureOf(AHardwareBuffer *buffer);
+
+    /**
+     * Returns a sync fd signaled once the commands issued so far are done. Waits for them instead,
+     * and returns -1, if the fence can't be created.
+     */
+    int createFence() const;
+
+    /**
+     * Deletes the textures and images. Must be called while the context is still current.
+     */
+    void release();
+
+    /**
+     * Forgets the textures without deleting them, after the context that owned them was lost.
+     */
+    void forget();
+
+private:
+    // The three frames of the triple buffer, and one for a buffer replaced after a resize.
+    static constexpr int kCacheSize = 4;
+
+    struct Entry {
+        // Holds a reference, so that a new buffer can't get the address of one still cached.
+        AHardwareBuffer *buffer = nullptr;
+        EGLImageKHR image = EGL_NO_IMAGE_KHR;
+        GLuint texture = 0;
+    };
+
+    bool prepared = false;
+    Entry entries[kCacheSize];
+    int nextEntry = 0;
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC getNativeClientBuffer = nullptr;
+    PFNEGLCREATEIMAGEKHRPROC createImage = nullptr;
+    PFNEGLDESTROYIMAGEKHRPROC destroyImage = nullptr;
+    PFNGLEGLIMAGETARGETTEXTURE2DOESPROC imageTargetTexture = nullptr;
+    PFNEGLCREATESYNCKHRPROC createSync = nullptr;
+    PFNEGLDESTROYSYNCKHRPROC destroySync = nullptr;
+    PFNEGLDUPNATIVEFENCEFDANDROIDPROC dupNativeFenceFd = nullptr;
+
+    void releaseEntry(Entry &entry);
+};
+
+#endif //TESTBED_HARDWAREBUFFERS_H
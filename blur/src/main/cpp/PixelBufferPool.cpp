@@ -0,0 +1,92 @@
+#include "PixelBufferPool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+static size_t roundUpToAlignment(size_t size) {
+    return (size + PixelBufferPool::kAlignment - 1) / PixelBufferPool::kAlignment * PixelBufferPool::kAlignment;
+}
+
+static uint8_t *allocateAligned(size_t size) {
+    // posix_memalign rather than aligned_alloc, which needs API 28.
+    void *bytes = nullptr;
+    if (posix_memalign(&bytes, PixelBufferPool::kAlignment, size) != 0) return nullptr;
+    return (uint8_t *) bytes;
+}
+
+PixelBufferPool::Buffer::Buffer(Buffer &&other) noexcept
+        : pool(std::exchange(other.pool, nullptr)), bytes(std::exchange(other.bytes, nullptr)),
+          capacity(std::exchange(other.capacity, 0)) {}
+
+PixelBufferPool::Buffer &PixelBufferPool::Buffer::operator=(Buffer &&other) noexcept {
+    if (this != &other) {
+        reset();
+        pool = std::exchange(other.pool, nullptr);
+        bytes = std::exchange(other.bytes, nullptr);
+        capacity = std::exchange(other.capacity, 0);
+    }
+    return *this;
+}
+
+void PixelBufferPool::Buffer::reset() {
+    if (bytes != nullptr) pool->recycle(bytes, capacity);
+    pool = nullptr;
+    bytes = nullptr;
+    capacity = 0;
+}
+
+void PixelBufferPool::prepare(size_t size, size_t count) {
+    size = roundUpToAlignment(size);
+    std::vector<uint8_t *> freed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (size != bufferSize) {
+            freed.swap(idleBuffers);
+            bufferSize = size;
+        }
+        // Allocated under the lock, prepare() is called once before the frames start flowing.
+        while (idleBuffers.size() < count) {
+            uint8_t *bytes = allocateAligned(bufferSize);
+            if (bytes == nullptr) break;
+            idleBuffers.push_back(bytes);
+        }
+    }
+    for (uint8_t *bytes: freed) free(bytes);
+}
+
+PixelBufferPool::Buffer PixelBufferPool::acquire(size_t size) {
+    size_t capacity;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (size <= bufferSize and not idleBuffers.empty()) {
+            uint8_t *bytes = idleBuffers.back();
+            idleBuffers.pop_back();
+            return {this, bytes, bufferSize};
+        }
+        capacity = std::max(roundUpToAlignment(size), bufferSize);
+    }
+    uint8_t *bytes = allocateAligned(capacity);
+    if (bytes == nullptr) return {};
+    return {this, bytes, capacity};
+}
+
+void PixelBufferPool::recycle(uint8_t *bytes, size_t capacity) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (capacity == bufferSize) {
+            idleBuffers.push_back(bytes);
+            return;
+        }
+    }
+    free(bytes);
+}
+
+void PixelBufferPool::clear() {
+    std::vector<uint8_t *> freed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freed.swap(idleBuffers);
+        bufferSize = 0;
+    }
+    for (uint8_t *bytes: freed) free(bytes);
+}
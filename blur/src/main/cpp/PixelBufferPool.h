@@ -0,0 +1,87 @@
+#ifndef TESTBED_PIXELBUFFERPOOL_H
+#define TESTBED_PIXELBUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Recycles the large pixel buffers of the frames, so that streaming frames of the same size doesn't
+ * allocate and free megabytes each time.
+ *
+ * Buffers are 64-byte aligned, a cache line and the widest SIMD load of the blur kernels, and are
+ * returned to the pool when their Buffer handle goes away. The pool can be used from any thread.
+ */
+class PixelBufferPool {
+public:
+    static constexpr size_t kAlignment = 64;
+
+    /**
+     * Owns a buffer of the pool, and gives it back when destroyed or assigned another one.
+     */
+    class Buffer {
+    public:
+        Buffer() = default;
+
+        Buffer(Buffer &&other) noexcept;
+
+        Buffer &operator=(Buffer &&other) noexcept;
+
+        Buffer(const Buffer &) = delete;
+
+        Buffer &operator=(const Buffer &) = delete;
+
+        ~Buffer() { reset(); }
+
+        uint8_t *data() const { return bytes; }
+
+        size_t size() const { return capacity; }
+
+        void reset();
+
+    private:
+        friend class PixelBufferPool;
+
+        Buffer(PixelBufferPool *pool, uint8_t *bytes, size_t capacity) : pool(pool), bytes(bytes), capacity(capacity) {}
+
+        PixelBufferPool *pool = nullptr;
+        uint8_t *bytes = nullptr;
+        size_t capacity = 0;
+    };
+
+    PixelBufferPool() = default;
+
+    PixelBufferPool(const PixelBufferPool &) = delete;
+
+    PixelBufferPool &operator=(const PixelBufferPool &) = delete;
+
+    ~PixelBufferPool() { clear(); }
+
+    /**
+     * Sizes the buffers for frames of bufferSize bytes and allocates count of them up front, so the
+     * first frames don't pay for it. Idle buffers of another size are freed.
+     */
+    void prepare(size_t bufferSize, size_t count);
+
+    /**
+     * Returns a buffer of at least size bytes, an idle one if there is one, or an empty Buffer if
+     * the memory ran out. Sizes above the prepared one are allocated and freed on their own.
+     */
+    Buffer acquire(size_t size);
+
+    /**
+     * Frees the idle buffers, and those still held when they come back, until the next prepare().
+     */
+    void clear();
+
+private:
+    std::mutex mutex;
+    // Guarded by mutex.
+    size_t bufferSize = 0;
+    std::vector<uint8_t *> idleBuffers;
+
+    void recycle(uint8_t *bytes, size_t capacity);
+};
+
+#endif //TESTBED_PIXELBUFFERPOOL_H
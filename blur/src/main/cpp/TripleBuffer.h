@@ -0,0 +1,62 @@
+#ifndef TESTBED_TRIPLEBUFFER_H
+#define TESTBED_TRIPLEBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Hands the newest of a stream of values from one producer thread to one consumer thread, without
+ * locks and without ever blocking either of them.
+ *
+ * There are three slots. The producer writes into its back slot and publishes it, which swaps it
+ * with the middle slot. The consumer takes the middle slot when a new value was published since it
+ * last did, by swapping it with its front slot. A value published before the consumer took the
+ * previous one is overwritten, so the consumer always gets the latest and the memory never grows.
+ *
+ * Each slot is only ever touched by the thread that currently owns it, so T needs no
+ * synchronization of its own and its buffers can be reused from one value to the next.
+ */
+template<typename T>
+class TripleBuffer {
+public:
+    /**
+     * The slot the producer writes the next value into. Producer thread only.
+     */
+    T &back() { return slots[backIndex]; }
+
+    /**
+     * Makes the back slot the newest value, dropping the previous one if it was not taken yet.
+     * Producer thread only.
+     */
+    void publish() {
+        // Release the writes to the slot, acquire those the consumer made to the one we get back.
+        backIndex = middle.exchange(backIndex bitor kFresh, std::memory_order_acq_rel) bitand kIndexMask;
+    }
+
+    /**
+     * Moves the newest value to the front slot if one was published since the last call, and
+     * returns whether it did. Consumer thread only.
+     */
+    bool acquire() {
+        if ((middle.load(std::memory_order_relaxed) bitand kFresh) == 0) return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) bitand kIndexMask;
+        return true;
+    }
+
+    /**
+     * The slot holding the value last acquired. Consumer thread only.
+     */
+    T &front() { return slots[frontIndex]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 3;
+    // Set in middle when its slot was published and not taken yet.
+    static constexpr uint8_t kFresh = 4;
+
+    T slots[3];
+    uint8_t backIndex = 0;
+    std::atomic<uint8_t> middle{1};
+    uint8_t frontIndex = 2;
+};
+
+#endif //TESTBED_TRIPLEBUFFER_H
@@ -3,12 +3,17 @@
 //
 
 #include "glblurringview.h"
+#include "GpuBlur.h"
+#include "HardwareBuffers.h"
+#include "PixelBufferPool.h"
+#include "TripleBuffer.h"
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <string>
 #include <cstring>
+#include <unistd.h>
 #include <android/log.h>
-#include <mutex>
-#include <queue>
 
 #define LOG_TAG "GLBlurringView"
 #define ANDROID_LOG_DEBUG 3
@@ -36,8 +41,34 @@ static const char *fragmentShaderCode = R"(
 
 static const unsigned int indices[] = {0, 1, 2, 2, 3, 0};
 
-std::queue<std::pair<jobject, void *>> mQueue;
-std::mutex mMutex;
+// A frame of blurAndDrawFrame, copied out of its bitmap so that the bitmap can be reused as soon as
+// the call returns. The rows are tightly packed, as the blur engines expect.
+struct Frame {
+    PixelBufferPool::Buffer pixels;
+    // Holds the frame instead of pixels when inHardwareBuffer, where onDrawFrame samples it without
+    // copying it. Its rows are padded to the stride of the allocation.
+    AHardwareBuffer *hardwareBuffer = nullptr;
+    bool inHardwareBuffer = false;
+    // Signaled once the GPU is done with the draws that sampled hardwareBuffer, -1 if there are none.
+    int releaseFence = -1;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t stride = 0;
+    bool is565 = false;
+};
+
+// The pixels of the frames that don't go into hardware buffers. prepareBlur sizes the pool, a slot of
+// blurredFrames gets its buffer the first time it needs one and keeps it from one frame to the next.
+// Declared first so that it is destroyed last, after the buffers of the slots came back to it.
+static PixelBufferPool framePixels;
+// From the thread of blurAndDrawFrame to the GL thread. onDrawFrame only uploads the newest frame,
+// those blurred in between are dropped.
+static TripleBuffer<Frame> blurredFrames;
+
+// Samples the hardware buffers of the frames. blurAndDrawFrame writes into them only while
+// hardwareBuffersEnabled, which the GL thread sets once it knows its context can sample them.
+static HardwareBufferTextures hardwareBufferTextures;
+static std::atomic<bool> hardwareBuffersEnabled{false};
 
 jmethodID requestRenderMethodId = nullptr;
 jobject glSurfaceView = nullptr;
@@ -52,12 +83,35 @@ static GLuint program = 0;
 static GLint mvpMatrixHandle = 0;
 
 static GLuint textures;
+// What onDrawFrame draws when no new frame arrived: textures, or the output of gpuBlur.
+static GLuint shownTexture = 0;
+// Whether shownTexture samples the hardware buffer of the front frame of blurredFrames, and so can't
+// be drawn again once that frame went back to blurAndDrawFrame.
+static bool shownTextureIsHardwareBuffer = false;
+// Format of the immutable storage of textures, GL_NONE until it's allocated.
+static GLenum textureInternalFormat = GL_NONE;
+
+// Pixel unpack buffers the frames are streamed through, used in turn so that writing a frame never
+// waits for the upload of the previous one.
+static constexpr int kUploadBufferCount = 2;
+static GLuint uploadBuffers[kUploadBufferCount];
+static GLsizeiptr uploadBufferSize = 0;
+static int nextUploadBuffer = 0;
+
 static GLfloat vpMatrix[16];
 static GLfloat modelMatrix[16];
 static GLfloat mvpMatrix[16];
 
 GLint bitmapWidth = 0;
 GLint bitmapHeight = 0;
+static GLint surfaceWidth = 0;
+static GLint surfaceHeight = 0;
+
+// Blurs the frames on the GPU once requestGpuBlur asked for it and onSurfaceChanged prepared it.
+// Otherwise the frames arrive blurred by the CPU engines.
+static GpuBlur gpuBlur;
+static int gpuBlurRadius = 0;
+static double gpuBlurResizeRatio = 1.0;
 
 static GLuint loadShader(GLenum type, const char *shaderCode);
 
@@ -75,6 +129,12 @@ static void initIndicies();
 
 static void printError(const std::string &msg);
 
+static void allocateTexture(GLenum internalFormat);
+
+static void allocateUploadBuffers(GLsizeiptr size);
+
+static void releaseTextureAndUploadBuffers();
+
 static void printError(const char *msg) {
     auto error = glGetError();
     if (error != GL_NO_ERROR) {
@@ -95,6 +155,14 @@ Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_onSurfac
 
     glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
+    // A new context, the names allocated in the previous one are gone with it.
+    textureInternalFormat = GL_NONE;
+    uploadBufferSize = 0;
+    shownTexture = 0;
+    gpuBlur.forget();
+    hardwareBufferTextures.forget();
+    hardwareBuffersEnabled = HardwareBufferApi::get() != nullptr and hardwareBufferTextures.prepare();
+
     glSurfaceView = env->NewGlobalRef(blurring_view);
     jclass glSurfaceViewClass = env->GetObjectClass(glSurfaceView);
     requestRenderMethodId = env->GetMethodID(glSurfaceViewClass, "requestRender", "()V");
@@ -109,25 +177,164 @@ static GLuint loadShader(GLenum type, const char *shaderCode) {
 }
 
 
+/**
+ * Uploads a frame to textures through the next unpack buffer, and returns false if it couldn't.
+ * copyPixels(mapped, size) copies the first size bytes of the frame, rows stride bytes apart,
+ * into the mapped buffer; it returns false to skip the frame.
+ */
+template<typename CopyPixels>
+static bool uploadFrame(uint32_t frameWidth, uint32_t frameHeight, uint32_t stride, bool is565, CopyPixels copyPixels) {
+    const GLenum internalFormat = is565 ? GL_RGB565 : GL_RGBA8;
+    // The storage is allocated for RGBA in onSurfaceChanged, low-RAM devices switch it once.
+    if (internalFormat != textureInternalFormat) allocateTexture(internalFormat);
+
+    const GLint bytesPerPixel = is565 ? 2 : 4;
+    const GLsizei width = std::min((GLint) frameWidth, bitmapWidth);
+    const GLsizei height = std::min((GLint) frameHeight, bitmapHeight);
+    if (width <= 0 or height <= 0) return false;
+    const GLsizeiptr size = (GLsizeiptr) stride * (height - 1) + width * bytesPerPixel;
+    // Only a bitmap wider than the surface needs more than the buffers have.
+    if (size > uploadBufferSize) allocateUploadBuffers(size);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffers[nextUploadBuffer]);
+    nextUploadBuffer = (nextUploadBuffer + 1) % kUploadBufferCount;
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT bitor GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped == nullptr) {
+        printError("glMapBufferRange");
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    if (not copyPixels(mapped, (size_t) size)) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+        // The contents were lost, e.g. to a display mode change. Skip the frame.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, textures);
+    // 565 rows are only 2-byte aligned when the width is odd.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, is565 ? 2 : 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint) (stride / bytesPerPixel));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, is565 ? GL_RGB : GL_RGBA,
+                    is565 ? GL_UNSIGNED_SHORT_5_6_5 : GL_UNSIGNED_BYTE, BUFFER_OFFSET(0));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return true;
+}
+
+/**
+ * Draws the bitmap if there is one, else the newest frame of blurAndDrawFrame if a new one arrived,
+ * else the last frame drawn again.
+ */
 extern "C"
 JNIEXPORT void JNICALL
 Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_onDrawFrame(JNIEnv *env, jobject thiz, jobject bitmap) {
-    void *pixels = nullptr;
-    if (AndroidBitmap_lockPixels(env, bitmap, (void **) &pixels) != 0) return;
+    bool uploaded = false;
+    GLuint frameTexture = textures;
+    if (bitmap != nullptr) {
+        AndroidBitmapInfo info;
+        if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS) return;
+
+        // The bitmap is only locked for the copy, the upload from the buffer is queued after.
+        uploaded = uploadFrame(info.width, info.height, info.stride, info.format == ANDROID_BITMAP_FORMAT_RGB_565,
+                               [env, bitmap](void *mapped, size_t size) {
+                                   void *pixels = nullptr;
+                                   if (AndroidBitmap_lockPixels(env, bitmap, (void **) &pixels) != 0) return false;
+                                   memcpy(mapped, pixels, size);
+                                   AndroidBitmap_unlockPixels(env, bitmap);
+                                   return true;
+                               });
+    } else if (blurredFrames.acquire()) {
+        // The previous front frame may be written into from now on.
+        if (shownTextureIsHardwareBuffer) shownTexture = 0;
+        shownTextureIsHardwareBuffer = false;
+
+        const Frame &frame = blurredFrames.front();
+        if (frame.inHardwareBuffer) {
+            // Sampled where the blur wrote it.
+            frameTexture = hardwareBufferTextures.textureOf(frame.hardwareBuffer);
+            uploaded = frameTexture != 0;
+        } else {
+            uploaded = uploadFrame(frame.width, frame.height, frame.stride, frame.is565,
+                                   [&frame](void *mapped, size_t size) {
+                                       memcpy(mapped, frame.pixels.data(), size);
+                                       return true;
+                                   });
+        }
+    }
+
+    if (uploaded) {
+        shownTexture = frameTexture;
+        shownTextureIsHardwareBuffer = frameTexture != textures;
+        if (gpuBlur.isPrepared()) {
+            shownTextureIsHardwareBuffer = false;
+            shownTexture = gpuBlur.blur(frameTexture);
+            glViewport(0, 0, surfaceWidth, surfaceHeight);
+            glUseProgram(program);
+        }
+    }
 
     glClear(GL_COLOR_BUFFER_BIT bitor GL_DEPTH_BUFFER_BIT);
+    if (shownTexture == 0) return;
+    glBindTexture(GL_TEXTURE_2D, shownTexture);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
 
-    glBindTexture(GL_TEXTURE_2D, textures);
+    Frame &front = blurredFrames.front();
+    if (front.inHardwareBuffer) {
+        // Handed back to blurAndDrawFrame with the frame, which waits on it before writing into the
+        // buffer again.
+        if (front.releaseFence >= 0) close(front.releaseFence);
+        front.releaseFence = hardwareBufferTextures.createFence();
+    }
+}
 
+/**
+ * Allocates the immutable storage of the texture for the size of the surface. Immutable storage
+ * can't be respecified, so a new texture replaces the previous one.
+ */
+static void allocateTexture(GLenum internalFormat) {
+    if (textureInternalFormat != GL_NONE) glDeleteTextures(1, &textures);
+    shownTexture = 0;
+
+    glGenTextures(1, &textures);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures);
+    glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, bitmapWidth, bitmapHeight);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    printError("glTexStorage2D");
+    textureInternalFormat = internalFormat;
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bitmapWidth, bitmapHeight, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+/**
+ * Allocates the unpack buffers, size bytes each.
+ */
+static void allocateUploadBuffers(GLsizeiptr size) {
+    if (uploadBufferSize != 0) glDeleteBuffers(kUploadBufferCount, uploadBuffers);
+
+    uploadBufferSize = size;
+    glGenBuffers(kUploadBufferCount, uploadBuffers);
+    for (GLuint buffer: uploadBuffers) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, uploadBufferSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    printError("glBufferData");
+    nextUploadBuffer = 0;
+}
 
-    AndroidBitmap_unlockPixels(env, bitmap);
+static void releaseTextureAndUploadBuffers() {
+    if (textureInternalFormat != GL_NONE) glDeleteTextures(1, &textures);
+    textureInternalFormat = GL_NONE;
+    shownTexture = 0;
+    if (uploadBufferSize != 0) glDeleteBuffers(kUploadBufferCount, uploadBuffers);
+    uploadBufferSize = 0;
 }
 
 
@@ -207,6 +414,8 @@ JNIEXPORT void JNICALL
 Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_onSurfaceChanged(JNIEnv *env, jobject thiz, jint width, jint height,
                                                                                          jintArray collecting_view_rect, jintArray window_rect) {
     glViewport(0, 0, width, height);
+    surfaceWidth = width;
+    surfaceHeight = height;
 
     jint *collecting_view_rect_array = env->GetIntArrayElements(collecting_view_rect, nullptr);
     jint *window_rect_array = env->GetIntArrayElements(window_rect, nullptr);
@@ -237,9 +446,16 @@ Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_onSurfac
     //multiplyMM(mvpMatrix, 0, vpMatrix, 0, modelMatrix, 0);
     glUniformMatrix4fv(mvpMatrixHandle, 1, false, mvpMatrix);
 
-    glGenTextures(1, &textures);
-    glActiveTexture(GL_TEXTURE0);
+    // Allocated once per surface size rather than on every frame. The frames of low-RAM devices
+    // are RGB_565, the first of them switches the format.
+    allocateTexture(textureInternalFormat == GL_NONE ? GL_RGBA8 : textureInternalFormat);
+    // 4 bytes per pixel fit the frames of both formats.
+    allocateUploadBuffers((GLsizeiptr) bitmapWidth * bitmapHeight * 4);
 
+    // The chain of the GPU blur follows the size of the frames.
+    if (gpuBlurRadius > 0 and not gpuBlur.prepare(bitmapWidth, bitmapHeight, gpuBlurRadius, gpuBlurResizeRatio)) {
+        gpuBlurRadius = 0;
+    }
 }
 
 static void initIndicies() {
@@ -297,33 +513,149 @@ static void setIdentityM(GLfloat *sm, int smOffset) {
 extern "C"
 JNIEXPORT void JNICALL
 Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_onPause(JNIEnv *env, jobject thiz) {
-    glDeleteTextures(1, &textures);
+    releaseTextureAndUploadBuffers();
+    gpuBlur.release();
+    hardwareBuffersEnabled = false;
+    hardwareBufferTextures.release();
     glDeleteBuffers(1, &verticesBufferObj);
     glDeleteBuffers(1, &uvsBufferObj);
     glDeleteBuffers(1, &indexBufferObj);
     glDeleteProgram(program);
 
     env->DeleteGlobalRef(glSurfaceView);
+    glSurfaceView = nullptr;
     requestRenderMethodId = nullptr;
 }
 
+static void releaseHardwareBuffer(Frame &frame) {
+    if (frame.releaseFence >= 0) close(frame.releaseFence);
+    frame.releaseFence = -1;
+    // The texture of onDrawFrame holds its own reference until the GPU is done with it.
+    if (frame.hardwareBuffer != nullptr) HardwareBufferApi::get()->release(frame.hardwareBuffer);
+    frame.hardwareBuffer = nullptr;
+}
+
+/**
+ * Makes the hardware buffer of the frame fit a width x height frame of the format, and locks it for
+ * the CPU once the GPU is done reading it. Returns the address of its pixels and their stride, in
+ * pixels, or nullptr if there is no such buffer.
+ */
+static uint8_t *lockHardwareBuffer(Frame &frame, uint32_t width, uint32_t height, bool is565, uint32_t *stride) {
+    const HardwareBufferApi *api = HardwareBufferApi::get();
+    const uint32_t format = is565 ? AHARDWAREBUFFER_FORMAT_R5G6B5_UNORM : AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+
+    AHardwareBuffer_Desc desc{};
+    if (frame.hardwareBuffer != nullptr) api->describe(frame.hardwareBuffer, &desc);
+    if (frame.hardwareBuffer == nullptr or desc.width != width or desc.height != height or desc.format != format) {
+        releaseHardwareBuffer(frame);
+        desc = AHardwareBuffer_Desc{};
+        desc.width = width;
+        desc.height = height;
+        desc.layers = 1;
+        desc.format = format;
+        // Read too, the blur works in place.
+        desc.usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN bitor AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN bitor
+                     AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE;
+        if (api->allocate(&desc, &frame.hardwareBuffer) != 0) {
+            frame.hardwareBuffer = nullptr;
+            return nullptr;
+        }
+        api->describe(frame.hardwareBuffer, &desc);
+    }
+
+    void *address = nullptr;
+    const int result = api->lock(frame.hardwareBuffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN bitor AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+                                 frame.releaseFence, nullptr, &address);
+    // Closed by the lock, even when it fails.
+    frame.releaseFence = -1;
+    if (result != 0) return nullptr;
+    *stride = desc.stride;
+    return (uint8_t *) address;
+}
+
 extern "C"
 JNIEXPORT void JNICALL
-Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_blurAndDrawFrame(JNIEnv *env, jobject thiz, jobject src_bitmap) {
+Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_blurAndDrawFrame(JNIEnv *env, jobject thiz, jobject src_bitmap, jboolean blur) {
+    AndroidBitmapInfo info;
+    if (AndroidBitmap_getInfo(env, src_bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS) return;
+    const bool is565 = info.format == ANDROID_BITMAP_FORMAT_RGB_565;
+    if (not is565 and info.format != ANDROID_BITMAP_FORMAT_RGBA_8888) return;
+    const size_t bytesPerPixel = is565 ? 2 : 4;
+
+    // Written into the hardware buffer onDrawFrame samples when its context can, which saves copying
+    // the frame into an unpack buffer and from there into the texture.
+    Frame &frame = blurredFrames.back();
+    uint32_t stride = info.width;
+    uint8_t *target = hardwareBuffersEnabled.load(std::memory_order_relaxed)
+                      ? lockHardwareBuffer(frame, info.width, info.height, is565, &stride) : nullptr;
+    frame.inHardwareBuffer = target != nullptr;
+    if (not frame.inHardwareBuffer) {
+        stride = info.width;
+        const size_t size = bytesPerPixel * info.width * info.height;
+        if (frame.pixels.size() < size) {
+            frame.pixels = framePixels.acquire(size);
+            if (frame.pixels.data() == nullptr) return;
+        }
+        target = frame.pixels.data();
+    }
+    const size_t rowSize = bytesPerPixel * stride;
+
     void *tPixels = nullptr;
+    bool blurred = AndroidBitmap_lockPixels(env, src_bitmap, (void **) &tPixels) == ANDROID_BITMAP_RESULT_SUCCESS;
+    if (blurred) {
+        // Only copied while locked, the caller can draw the next frame into the bitmap during the blur.
+        if (info.stride == rowSize) {
+            memcpy(target, tPixels, rowSize * info.height);
+        } else {
+            for (uint32_t y = 0; y < info.height; y++) {
+                memcpy(target + y * rowSize, (const uint8_t *) tPixels + (size_t) y * info.stride, bytesPerPixel * info.width);
+            }
+        }
+        AndroidBitmap_unlockPixels(env, src_bitmap);
+    }
+
+    // Left to the GPU blur when it's prepared.
+    if (blurred and blur) {
+        // The rows of a hardware buffer may be padded, the engines skip the padding.
+        AndroidBitmapInfo targetInfo = info;
+        targetInfo.stride = (uint32_t) rowSize;
+        blurred = is565 ? blurBitmapPixels(rgbStackBlur, blurOptions, target, targetInfo)
+                        : blurBitmapPixels(stackBlur, blurOptions, target, targetInfo);
+    }
+    if (frame.inHardwareBuffer) HardwareBufferApi::get()->unlock(frame.hardwareBuffer, nullptr);
+    if (not blurred) return;
 
-    AndroidBitmap_lockPixels(env, src_bitmap, (void **) &tPixels);
-    stackBlur->blur((unsigned int *) tPixels);
-    AndroidBitmap_unlockPixels(env, src_bitmap);
-    //std::unique_lock<std::mutex> lock(mMutex);
+    frame.width = info.width;
+    frame.height = info.height;
+    frame.stride = (uint32_t) rowSize;
+    frame.is565 = is565;
 
-    mQueue.push(std::pair(src_bitmap, tPixels));
-    //env->CallVoidMethod(glSurfaceView, requestRenderMethodId);
+    blurredFrames.publish();
+    // The caller requests the render, onDrawFrame(null) then draws the newest frame.
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_prepareBlur(JNIEnv *env, jobject thiz, jint width, jint height,
                                                                                     jint radius, jdouble resize_ratio) {
+    blurOptions = BlurOptions{radius, resize_ratio, AlphaMode::OPAQUE};
     stackBlur->prepare(width, height, radius, resize_ratio);
+    rgbStackBlur->onDestroy();
+    // 4 bytes per pixel fit the frames of both formats. Nothing is allocated up front: the frames
+    // usually go into hardware buffers, and the pool only backs those that can't.
+    framePixels.prepare((size_t) width * height * 4, 0);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_requestGpuBlur(JNIEnv *env, jobject thiz, jint radius, jdouble resize_ratio) {
+    // Called on the GL thread before onSurfaceChanged, which prepares it for the size of the surface.
+    gpuBlurRadius = radius;
+    gpuBlurResizeRatio = resize_ratio;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_io_github_pknujsp_blur_natives_NativeGLBlurringImpl_00024Companion_isGpuBlurPrepared(JNIEnv *env, jobject thiz) {
+    return gpuBlur.isPrepared();
 }
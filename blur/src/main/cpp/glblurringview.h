@@ -12,10 +12,12 @@
 #include <android/surface_control.h>
 #include <android/hardware_buffer.h>
 #include <android/native_window.h>
-#include "stackblur/abgr-stackblur.h"
+#include "BlurManager.h"
 
 #define BUFFER_OFFSET(offset)   ((GLvoid*) (offset))
 
 static ABGRStackBlur *stackBlur = new ABGRStackBlur();
+static RGBStackBlur *rgbStackBlur = new RGBStackBlur();
+static BlurOptions blurOptions;
 
 #endif //TESTBED_GLBLURRINGVIEW_H
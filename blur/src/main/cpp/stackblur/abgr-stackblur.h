@@ -6,21 +6,186 @@
 #define TESTBED_ABGR_STACKBLUR_H
 
 #include "blur.h"
+#include "pixel-sums.h"
+#include "../toolkit/Utils.h"
 
 class ABGRStackBlur : public Blur<unsigned int> {
 private:
+    // Checked once; the vector kernels are only compiled in when the target has NEON or SSE4.1.
+    const bool usesSimd = renderscript::cpuSupportsSimd();
+
+#ifdef STACKBLUR_HAS_SIMD
+
+    /**
+     * Same algorithm as processingRowScalar, with the channel sums held in one vector. The alpha lane is
+     * always blurred along and only written back when blurAlpha, so the output is bit-identical to the
+     * scalar kernel in both modes.
+     */
+    template<bool blurAlpha>
+    void processingRowSimd(unsigned int *imagePixels, const int startRow, const int endRow) {
+        const int widthMax = sharedValues->widthMax;
+        const int blurRadius = sharedValues->blurRadius;
+        const int targetWidth = sharedValues->targetWidth;
+        const int divisor = sharedValues->divisor;
+        const unsigned int multiplySum = sharedValues->multiplySum;
+        const int shiftSum = sharedValues->shiftSum;
 
-public:
+        unsigned int blurStack[divisor];
 
-    void processingRow(unsigned int *imagePixels, const int startRow, const int endRow) override {
+        for (int row = startRow; row <= endRow; row++) {
+            PixelSums sum, sumInput, sumOutput;
+            unsigned int *rowPixels = imagePixels + row * passStride;
+            int inPixelIndex = 0;
+
+            for (int rad = 0; rad <= blurRadius; rad++) {
+                blurStack[rad] = rowPixels[0];
+                const PixelSums pixel(rowPixels[0]);
+                sum += pixel * (rad + 1);
+                sumOutput += pixel;
+
+                if (rad >= 1) {
+                    if (rad <= widthMax) inPixelIndex++;
+                    blurStack[rad + blurRadius] = rowPixels[inPixelIndex];
+                    const PixelSums inPixel(rowPixels[inPixelIndex]);
+                    sum += inPixel * (blurRadius + 1 - rad);
+                    sumInput += inPixel;
+                }
+            }
+
+            int stackPointer = blurRadius;
+            int colOffset = min(blurRadius, widthMax);
+            inPixelIndex = colOffset;
+
+            for (int col = 0; col < targetWidth; col++) {
+                if constexpr (blurAlpha) {
+                    rowPixels[col] = sum.toPixel(multiplySum, shiftSum);
+                } else {
+                    rowPixels[col] = (rowPixels[col] bitand ARGB_PIXEL_MASK) bitor
+                                     (sum.toPixel(multiplySum, shiftSum) bitand ~ARGB_PIXEL_MASK);
+                }
+
+                sum -= sumOutput;
+
+                int stackIndex = stackPointer + divisor - blurRadius;
+                if (stackIndex >= divisor) stackIndex -= divisor;
+                sumOutput -= PixelSums(blurStack[stackIndex]);
+
+                if (colOffset < widthMax) {
+                    inPixelIndex++;
+                    colOffset++;
+                }
+
+                blurStack[stackIndex] = rowPixels[inPixelIndex];
+                sumInput += PixelSums(rowPixels[inPixelIndex]);
+                sum += sumInput;
+
+                if (++stackPointer >= divisor) stackPointer = 0;
+
+                const PixelSums outPixel(blurStack[stackPointer]);
+                sumOutput += outPixel;
+                sumInput -= outPixel;
+            }
+        }
+    }
+
+    // Same algorithm as processingColumnScalar, see processingRowSimd.
+    template<bool blurAlpha>
+    void processingColumnSimd(unsigned int *imagePixels, const int startColumn, const int endColumn) {
+        const int heightMax = sharedValues->heightMax;
+        const int blurRadius = sharedValues->blurRadius;
+        const int targetHeight = sharedValues->targetHeight;
+        const int divisor = sharedValues->divisor;
+        const unsigned int multiplySum = sharedValues->multiplySum;
+        const int shiftSum = sharedValues->shiftSum;
+
+        unsigned int blurStack[divisor * COLUMN_BLOCK];
+        PixelSums sum[COLUMN_BLOCK], sumInput[COLUMN_BLOCK], sumOutput[COLUMN_BLOCK];
+
+        for (int blockStart = startColumn; blockStart <= endColumn; blockStart += COLUMN_BLOCK) {
+            const int blockWidth = min(COLUMN_BLOCK, endColumn - blockStart + 1);
+            unsigned int *blockPixels = imagePixels + blockStart;
+
+            for (int c = 0; c < blockWidth; c++) sum[c] = sumInput[c] = sumOutput[c] = PixelSums();
+
+            int sourceRow = 0;
+
+            for (int rad = 0; rad <= blurRadius; rad++) {
+                const unsigned int *sourcePixels = blockPixels + sourceRow * passStride;
+                unsigned int *stackRow = blurStack + rad * COLUMN_BLOCK;
+                for (int c = 0; c < blockWidth; c++) {
+                    stackRow[c] = sourcePixels[c];
+                    const PixelSums pixel(sourcePixels[c]);
+                    sum[c] += pixel * (rad + 1);
+                    sumOutput[c] += pixel;
+                }
+
+                if (rad >= 1) {
+                    if (rad <= heightMax) sourceRow++;
+                    const unsigned int *inRow = blockPixels + sourceRow * passStride;
+                    stackRow = blurStack + (rad + blurRadius) * COLUMN_BLOCK;
+                    for (int c = 0; c < blockWidth; c++) {
+                        stackRow[c] = inRow[c];
+                        const PixelSums inPixel(inRow[c]);
+                        sum[c] += inPixel * (blurRadius + 1 - rad);
+                        sumInput[c] += inPixel;
+                    }
+                }
+            }
+
+            int stackPointer = blurRadius;
+            int yOffset = min(blurRadius, heightMax);
+
+            for (int y = 0; y < targetHeight; y++) {
+                unsigned int *outRow = blockPixels + y * passStride;
+                for (int c = 0; c < blockWidth; c++) {
+                    if constexpr (blurAlpha) {
+                        outRow[c] = sum[c].toPixel(multiplySum, shiftSum);
+                    } else {
+                        outRow[c] = (outRow[c] bitand ARGB_PIXEL_MASK) bitor (sum[c].toPixel(multiplySum, shiftSum) bitand ~ARGB_PIXEL_MASK);
+                    }
+                    sum[c] -= sumOutput[c];
+                }
+
+                int stackIndex = stackPointer + divisor - blurRadius;
+                if (stackIndex >= divisor) stackIndex -= divisor;
+                unsigned int *stackRow = blurStack + stackIndex * COLUMN_BLOCK;
+
+                if (yOffset < heightMax) yOffset++;
+                const unsigned int *inRow = blockPixels + yOffset * passStride;
+
+                for (int c = 0; c < blockWidth; c++) {
+                    sumOutput[c] -= PixelSums(stackRow[c]);
+                    stackRow[c] = inRow[c];
+                    sumInput[c] += PixelSums(inRow[c]);
+                    sum[c] += sumInput[c];
+                }
+
+                if (++stackPointer >= divisor) stackPointer = 0;
+                stackRow = blurStack + stackPointer * COLUMN_BLOCK;
+
+                for (int c = 0; c < blockWidth; c++) {
+                    const PixelSums outPixel(stackRow[c]);
+                    sumOutput[c] += outPixel;
+                    sumInput[c] -= outPixel;
+                }
+            }
+        }
+    }
+
+#endif
+
+    template<bool blurAlpha>
+    void processingRowScalar(unsigned int *imagePixels, const int startRow, const int endRow) {
         long sumRed, sumGreen, sumBlue;
         long sumInputRed, sumInputGreen, sumInputBlue;
         long sumOutputRed, sumOutputGreen, sumOutputBlue;
+        // Only used when blurAlpha.
+        long sumAlpha, sumInputAlpha, sumOutputAlpha;
         int startPixelIndex, inPixelIndex, outputPixelIndex;
         int stackStart, stackPointer, stackIndex;
         int colOffset;
 
-        unsigned int red, green, blue;
+        unsigned int red, green, blue, alpha;
         int multiplier;
 
         const int widthMax = sharedValues->widthMax;
@@ -38,7 +203,8 @@ public:
 
         for (int row = startRow; row <= endRow; row++) {
             sumRed = sumGreen = sumBlue = sumInputRed = sumInputGreen = sumInputBlue = sumOutputRed = sumOutputGreen = sumOutputBlue = 0;
-            startPixelIndex = row * targetWidth;
+            sumAlpha = sumInputAlpha = sumOutputAlpha = 0;
+            startPixelIndex = row * passStride;
             inPixelIndex = startPixelIndex;
             stackIndex = blurRadius;
 
@@ -60,6 +226,12 @@ public:
                 sumOutputGreen += green;
                 sumOutputBlue += blue;
 
+                if constexpr (blurAlpha) {
+                    alpha = ((pixel >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
+                    sumAlpha += alpha * multiplier;
+                    sumOutputAlpha += alpha;
+                }
+
                 if (rad >= 1) {
                     if (rad <= widthMax) inPixelIndex++;
                     stackIndex = rad + blurRadius;
@@ -80,6 +252,12 @@ public:
                     sumInputRed += red;
                     sumInputGreen += green;
                     sumInputBlue += blue;
+
+                    if constexpr (blurAlpha) {
+                        alpha = ((pixel >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
+                        sumAlpha += alpha * multiplier;
+                        sumInputAlpha += alpha;
+                    }
                 }
             }
 
@@ -87,12 +265,18 @@ public:
             stackPointer = blurRadius;
             colOffset = blurRadius;
             if (colOffset > widthMax) colOffset = widthMax;
-            inPixelIndex = colOffset + row * targetWidth;
+            inPixelIndex = colOffset + row * passStride;
             outputPixelIndex = startPixelIndex;
 
             for (int col = 0; col < targetWidth; col++) {
+                if constexpr (blurAlpha) {
+                    alpha = (((sumAlpha * multiplySum) >> shiftSum) bitand ARGB_ALPHA_MASK) << ARGB_ALPHA_SHIFT;
+                } else {
+                    alpha = imagePixels[outputPixelIndex] bitand ARGB_PIXEL_MASK;
+                }
+
                 imagePixels[outputPixelIndex] =
-                        (unsigned int) ((imagePixels[outputPixelIndex] bitand ARGB_PIXEL_MASK) bitor
+                        (unsigned int) (alpha bitor
                                         ((((sumRed * multiplySum) >> shiftSum) bitand ARGB_RED_MASK) << ARGB_RED_SHIFT) bitor
                                         ((((sumGreen * multiplySum) >> shiftSum) bitand ARGB_GREEN_MASK) << ARGB_GREEN_SHIFT) bitor
                                         (((sumBlue * multiplySum) >> shiftSum) bitand ARGB_BLUE_MASK));
@@ -101,6 +285,7 @@ public:
                 sumRed -= sumOutputRed;
                 sumGreen -= sumOutputGreen;
                 sumBlue -= sumOutputBlue;
+                if constexpr (blurAlpha) sumAlpha -= sumOutputAlpha;
 
                 stackStart = stackPointer + divisor - blurRadius;
                 if (stackStart >= divisor) stackStart -= divisor;
@@ -109,6 +294,7 @@ public:
                 sumOutputRed -= ((blurStack[stackIndex] >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
                 sumOutputGreen -= ((blurStack[stackIndex] >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
                 sumOutputBlue -= (blurStack[stackIndex] bitand ARGB_BLUE_MASK);
+                if constexpr (blurAlpha) sumOutputAlpha -= ((blurStack[stackIndex] >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
 
                 if (colOffset < widthMax) {
                     inPixelIndex++;
@@ -131,6 +317,11 @@ public:
                 sumGreen += sumInputGreen;
                 sumBlue += sumInputBlue;
 
+                if constexpr (blurAlpha) {
+                    sumInputAlpha += ((pixel >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
+                    sumAlpha += sumInputAlpha;
+                }
+
                 if (++stackPointer >= divisor) stackPointer = 0;
                 stackIndex = stackPointer;
 
@@ -147,133 +338,290 @@ public:
                 sumInputRed -= red;
                 sumInputGreen -= green;
                 sumInputBlue -= blue;
+
+                if constexpr (blurAlpha) {
+                    alpha = ((pixel >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
+                    sumOutputAlpha += alpha;
+                    sumInputAlpha -= alpha;
+                }
             }
         }
     }
 
-    void processingColumn(unsigned int *imagePixels, const int startColumn, const int endColumn) override {
+    template<bool blurAlpha>
+    void processingColumnScalar(unsigned int *imagePixels, const int startColumn, const int endColumn) {
         const int heightMax = sharedValues->heightMax;
         const int blurRadius = sharedValues->blurRadius;
-        const int targetWidth = sharedValues->targetWidth;
         const int targetHeight = sharedValues->targetHeight;
         const int divisor = sharedValues->divisor;
         const int multiplySum = sharedValues->multiplySum;
         const int shiftSum = sharedValues->shiftSum;
 
-        int yOffset, stackStart, stackIndex, stackPointer, sourceIndex, destinationIndex;
+        unsigned int red, green, blue, alpha;
+        unsigned int pixel;
 
-        long sumRed, sumGreen, sumBlue, sumInputRed, sumInputGreen, sumInputBlue, sumOutputRed, sumOutputGreen, sumOutputBlue;
+        // Columns are processed COLUMN_BLOCK at a time, so that each row access reads adjacent pixels
+        // instead of one pixel per cache line. The stack pointer advances identically for every column
+        // of a block; only the stack contents and the sums are kept per column.
+        unsigned int blurStack[divisor * COLUMN_BLOCK];
+        ChannelSums sum[COLUMN_BLOCK], sumInput[COLUMN_BLOCK], sumOutput[COLUMN_BLOCK];
 
-        unsigned int red, green, blue;
-        unsigned int blurStack[divisor];
-        unsigned int pixel;
+        for (int blockStart = startColumn; blockStart <= endColumn; blockStart += COLUMN_BLOCK) {
+            const int blockWidth = min(COLUMN_BLOCK, endColumn - blockStart + 1);
+            unsigned int *blockPixels = imagePixels + blockStart;
 
-        for (int col = startColumn; col <= endColumn; col++) {
-            sumOutputBlue = sumOutputGreen = sumOutputRed = sumInputBlue = sumInputGreen = sumInputRed = sumBlue = sumGreen = sumRed = 0;
-            sourceIndex = col;
+            for (int c = 0; c < blockWidth; c++) sum[c] = sumInput[c] = sumOutput[c] = ChannelSums();
+
+            int sourceRow = 0;
 
             for (int rad = 0; rad <= blurRadius; rad++) {
-                stackIndex = rad;
-                pixel = imagePixels[sourceIndex];
-                blurStack[stackIndex] = pixel;
+                const unsigned int *sourcePixels = blockPixels + sourceRow * passStride;
+                unsigned int *stackRow = blurStack + rad * COLUMN_BLOCK;
+                int multiplier = rad + 1;
 
-                red = ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
-                green = ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
-                blue = (pixel bitand ARGB_BLUE_MASK);
+                for (int c = 0; c < blockWidth; c++) {
+                    pixel = sourcePixels[c];
+                    stackRow[c] = pixel;
 
-                int multiplier = rad + 1;
+                    red = ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
+                    green = ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
+                    blue = (pixel bitand ARGB_BLUE_MASK);
 
-                sumRed += red * multiplier;
-                sumGreen += green * multiplier;
-                sumBlue += blue * multiplier;
+                    sum[c].red += red * multiplier;
+                    sum[c].green += green * multiplier;
+                    sum[c].blue += blue * multiplier;
 
-                sumOutputRed += red;
-                sumOutputGreen += green;
-                sumOutputBlue += blue;
+                    sumOutput[c].red += red;
+                    sumOutput[c].green += green;
+                    sumOutput[c].blue += blue;
+
+                    if constexpr (blurAlpha) {
+                        alpha = ((pixel >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
+                        sum[c].alpha += alpha * multiplier;
+                        sumOutput[c].alpha += alpha;
+                    }
+                }
 
                 if (rad >= 1) {
-                    if (rad <= heightMax) sourceIndex += targetWidth;
+                    if (rad <= heightMax) sourceRow++;
+                    const unsigned int *inRow = blockPixels + sourceRow * passStride;
+                    stackRow = blurStack + (rad + blurRadius) * COLUMN_BLOCK;
+                    multiplier = blurRadius + 1 - rad;
 
-                    stackIndex = rad + blurRadius;
-                    pixel = imagePixels[sourceIndex];
-                    blurStack[stackIndex] = pixel;
+                    for (int c = 0; c < blockWidth; c++) {
+                        pixel = inRow[c];
+                        stackRow[c] = pixel;
 
-                    multiplier = blurRadius + 1 - rad;
+                        red = ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
+                        green = ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
+                        blue = (pixel bitand ARGB_BLUE_MASK);
 
-                    red = ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
-                    green = ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
-                    blue = (pixel bitand ARGB_BLUE_MASK);
+                        sum[c].red += red * multiplier;
+                        sum[c].green += green * multiplier;
+                        sum[c].blue += blue * multiplier;
 
-                    sumRed += red * multiplier;
-                    sumGreen += green * multiplier;
-                    sumBlue += blue * multiplier;
+                        sumInput[c].red += red;
+                        sumInput[c].green += green;
+                        sumInput[c].blue += blue;
 
-                    sumInputRed += red;
-                    sumInputGreen += green;
-                    sumInputBlue += blue;
+                        if constexpr (blurAlpha) {
+                            alpha = ((pixel >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
+                            sum[c].alpha += alpha * multiplier;
+                            sumInput[c].alpha += alpha;
+                        }
+                    }
                 }
             }
 
-            stackPointer = blurRadius;
-            yOffset = min(blurRadius, heightMax);
-            sourceIndex = col + yOffset * targetWidth;
-            destinationIndex = col;
+            int stackPointer = blurRadius;
+            int yOffset = min(blurRadius, heightMax);
 
             for (int y = 0; y < targetHeight; y++) {
-                imagePixels[destinationIndex] =
-                        (unsigned int) ((imagePixels[destinationIndex] bitand ARGB_PIXEL_MASK) bitor
-                                        ((((sumRed * multiplySum) >> shiftSum) bitand ARGB_RED_MASK) << ARGB_RED_SHIFT) bitor
-                                        ((((sumGreen * multiplySum) >> shiftSum) bitand ARGB_GREEN_MASK) << ARGB_GREEN_SHIFT) bitor
-                                        ((((sumBlue * multiplySum) >> shiftSum) bitand ARGB_BLUE_MASK)));
-
-                destinationIndex += targetWidth;
-                sumRed -= sumOutputRed;
-                sumGreen -= sumOutputGreen;
-                sumBlue -= sumOutputBlue;
+                unsigned int *outRow = blockPixels + y * passStride;
+
+                for (int c = 0; c < blockWidth; c++) {
+                    if constexpr (blurAlpha) {
+                        alpha = (((sum[c].alpha * multiplySum) >> shiftSum) bitand ARGB_ALPHA_MASK) << ARGB_ALPHA_SHIFT;
+                    } else {
+                        alpha = outRow[c] bitand ARGB_PIXEL_MASK;
+                    }
+
+                    outRow[c] = (unsigned int) (alpha bitor
+                                                ((((sum[c].red * multiplySum) >> shiftSum) bitand ARGB_RED_MASK) << ARGB_RED_SHIFT) bitor
+                                                ((((sum[c].green * multiplySum) >> shiftSum) bitand ARGB_GREEN_MASK) << ARGB_GREEN_SHIFT) bitor
+                                                ((((sum[c].blue * multiplySum) >> shiftSum) bitand ARGB_BLUE_MASK)));
+
+                    sum[c].red -= sumOutput[c].red;
+                    sum[c].green -= sumOutput[c].green;
+                    sum[c].blue -= sumOutput[c].blue;
+                    if constexpr (blurAlpha) sum[c].alpha -= sumOutput[c].alpha;
+                }
 
-                stackStart = stackPointer + divisor - blurRadius;
+                int stackStart = stackPointer + divisor - blurRadius;
                 if (stackStart >= divisor) stackStart -= divisor;
-                stackIndex = stackStart;
+                unsigned int *stackRow = blurStack + stackStart * COLUMN_BLOCK;
 
-                pixel = blurStack[stackIndex];
+                if (yOffset < heightMax) yOffset++;
+                const unsigned int *inRow = blockPixels + yOffset * passStride;
 
-                sumOutputRed -= ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
-                sumOutputGreen -= ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
-                sumOutputBlue -= (pixel bitand ARGB_BLUE_MASK);
+                for (int c = 0; c < blockWidth; c++) {
+                    pixel = stackRow[c];
 
-                if (yOffset < heightMax) {
-                    sourceIndex += targetWidth;
-                    yOffset++;
-                }
+                    sumOutput[c].red -= ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
+                    sumOutput[c].green -= ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
+                    sumOutput[c].blue -= (pixel bitand ARGB_BLUE_MASK);
+                    if constexpr (blurAlpha) sumOutput[c].alpha -= ((pixel >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
 
-                blurStack[stackIndex] = imagePixels[sourceIndex];
+                    pixel = inRow[c];
+                    stackRow[c] = pixel;
 
-                pixel = imagePixels[sourceIndex];
+                    sumInput[c].red += ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
+                    sumInput[c].green += ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
+                    sumInput[c].blue += (pixel bitand ARGB_BLUE_MASK);
 
-                sumInputRed += ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
-                sumInputGreen += ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
-                sumInputBlue += (pixel bitand ARGB_BLUE_MASK);
+                    sum[c].red += sumInput[c].red;
+                    sum[c].green += sumInput[c].green;
+                    sum[c].blue += sumInput[c].blue;
 
-                sumRed += sumInputRed;
-                sumGreen += sumInputGreen;
-                sumBlue += sumInputBlue;
+                    if constexpr (blurAlpha) {
+                        sumInput[c].alpha += ((pixel >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
+                        sum[c].alpha += sumInput[c].alpha;
+                    }
+                }
 
                 if (++stackPointer >= divisor) stackPointer = 0;
-                stackIndex = stackPointer;
+                stackRow = blurStack + stackPointer * COLUMN_BLOCK;
 
-                pixel = blurStack[stackIndex];
+                for (int c = 0; c < blockWidth; c++) {
+                    pixel = stackRow[c];
 
-                red = ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
-                green = ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
-                blue = (pixel bitand ARGB_BLUE_MASK);
+                    red = ((pixel >> ARGB_RED_SHIFT) bitand ARGB_RED_MASK);
+                    green = ((pixel >> ARGB_GREEN_SHIFT) bitand ARGB_GREEN_MASK);
+                    blue = (pixel bitand ARGB_BLUE_MASK);
 
-                sumOutputRed += red;
-                sumOutputGreen += green;
-                sumOutputBlue += blue;
+                    sumOutput[c].red += red;
+                    sumOutput[c].green += green;
+                    sumOutput[c].blue += blue;
 
-                sumInputRed -= red;
-                sumInputGreen -= green;
-                sumInputBlue -= blue;
+                    sumInput[c].red -= red;
+                    sumInput[c].green -= green;
+                    sumInput[c].blue -= blue;
+
+                    if constexpr (blurAlpha) {
+                        alpha = ((pixel >> ARGB_ALPHA_SHIFT) bitand ARGB_ALPHA_MASK);
+                        sumOutput[c].alpha += alpha;
+                        sumInput[c].alpha -= alpha;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Spreads the four 8-bit channels of a pixel into the four 16-bit lanes of a 64-bit word, so
+     * that sums and weighted blends of all channels take one integer operation.
+     */
+    static inline uint64_t spreadChannels(const unsigned int pixel) {
+        return (pixel bitand 0x00ff00ffULL) bitor ((uint64_t) (pixel bitand 0xff00ff00U) << 24);
+    }
+
+    static inline unsigned int packChannels(const uint64_t channels) {
+        return (unsigned int) ((channels bitand 0x00ff00ffULL) bitor ((channels >> 24) bitand 0xff00ff00ULL));
+    }
+
+    // (a * (256 - weight) + b * weight) / 256 for each lane. Lanes stay below 0x10000, so they never carry.
+    static inline uint64_t blendChannels(const uint64_t a, const uint64_t b, const unsigned int weight) {
+        return ((a * (256 - weight) + b * weight) >> 8) bitand 0x00ff00ff00ff00ffULL;
+    }
+
+public:
+
+    void processingRow(unsigned int *imagePixels, const int startRow, const int endRow) override {
+        const bool blurAlpha = sharedValues->alphaMode == AlphaMode::PREMULTIPLIED;
+#ifdef STACKBLUR_HAS_SIMD
+        if (usesSimd) {
+            if (blurAlpha) processingRowSimd<true>(imagePixels, startRow, endRow);
+            else processingRowSimd<false>(imagePixels, startRow, endRow);
+            return;
+        }
+#endif
+        if (blurAlpha) processingRowScalar<true>(imagePixels, startRow, endRow);
+        else processingRowScalar<false>(imagePixels, startRow, endRow);
+    }
+
+    void processingColumn(unsigned int *imagePixels, const int startColumn, const int endColumn) override {
+        const bool blurAlpha = sharedValues->alphaMode == AlphaMode::PREMULTIPLIED;
+#ifdef STACKBLUR_HAS_SIMD
+        if (usesSimd) {
+            if (blurAlpha) processingColumnSimd<true>(imagePixels, startColumn, endColumn);
+            else processingColumnSimd<false>(imagePixels, startColumn, endColumn);
+            return;
+        }
+#endif
+        if (blurAlpha) processingColumnScalar<true>(imagePixels, startColumn, endColumn);
+        else processingColumnScalar<false>(imagePixels, startColumn, endColumn);
+    }
+
+    void processingDownscale(const unsigned int *imagePixels, const int startRow, const int endRow) override {
+        const int targetWidth = sharedValues->targetWidth;
+
+        for (int row = startRow; row <= endRow; row++) {
+            const int firstY = downscaleY[row];
+            const int lastY = max(downscaleY[row + 1], firstY + 1);
+            unsigned int *outPixel = resizedPixels.data() + row * targetWidth;
+
+            for (int col = 0; col < targetWidth; col++) {
+                const int firstX = downscaleX[col];
+                const int lastX = max(downscaleX[col + 1], firstX + 1);
+                unsigned int sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+
+                for (int y = firstY; y < lastY; y++) {
+                    // A box is at most ceil(resizeRatio) pixels wide, far below the 257 pixels that
+                    // would overflow a 16-bit lane.
+                    const unsigned int *inPixel = imagePixels + y * srcStride;
+                    uint64_t rowSum = 0;
+                    for (int x = firstX; x < lastX; x++) rowSum += spreadChannels(inPixel[x]);
+
+                    sum0 += rowSum bitand 0xffff;
+                    sum1 += (rowSum >> 16) bitand 0xffff;
+                    sum2 += (rowSum >> 32) bitand 0xffff;
+                    sum3 += rowSum >> 48;
+                }
+
+                const unsigned int area = (lastX - firstX) * (lastY - firstY);
+                const unsigned int half = area / 2;
+                *outPixel++ = packChannels((uint64_t) ((sum0 + half) / area) bitor ((uint64_t) ((sum1 + half) / area) << 16) bitor
+                                           ((uint64_t) ((sum2 + half) / area) << 32) bitor ((uint64_t) ((sum3 + half) / area) << 48));
+            }
+        }
+    }
+
+    void processingUpscale(unsigned int *imagePixels, const int startRow, const int endRow) override {
+        const int srcWidth = sharedValues->srcWidth;
+        const int srcHeight = sharedValues->srcHeight;
+        const int targetWidth = sharedValues->targetWidth;
+        const int targetHeight = sharedValues->targetHeight;
+        const int widthMax = sharedValues->widthMax;
+        const int heightMax = sharedValues->heightMax;
+        // Like the in-place path, OPAQUE keeps the original alpha and PREMULTIPLIED takes the blurred one.
+        const unsigned int keptMask = sharedValues->alphaMode == AlphaMode::PREMULTIPLIED ? 0 : ARGB_PIXEL_MASK;
+
+        for (int row = startRow; row <= endRow; row++) {
+            const int position = upscalePosition(row, srcHeight, targetHeight);
+            const unsigned int weightY = position bitand 0xff;
+            const unsigned int *topRow = resizedPixels.data() + (position >> 8) * targetWidth;
+            const unsigned int *bottomRow = resizedPixels.data() + min((position >> 8) + 1, heightMax) * targetWidth;
+            unsigned int *outPixel = imagePixels + row * srcStride;
+
+            for (int col = 0; col < srcWidth; col++) {
+                const int left = upscaleX[col];
+                const int right = min(left + 1, widthMax);
+                const unsigned int weightX = upscaleWeightX[col];
+
+                const uint64_t top = blendChannels(spreadChannels(topRow[left]), spreadChannels(topRow[right]), weightX);
+                const uint64_t bottom = blendChannels(spreadChannels(bottomRow[left]), spreadChannels(bottomRow[right]), weightX);
+
+                outPixel[col] = (outPixel[col] bitand keptMask) bitor (packChannels(blendChannels(top, bottom, weightY)) bitand ~keptMask);
             }
         }
     }
@@ -16,6 +16,7 @@
 #include <unistd.h>
 #include <sys/sysinfo.h>
 #include <mutex>
+#include <cstdint>
 #include "threadpool.h"
 
 using namespace std;
@@ -28,90 +29,176 @@ using namespace std;
 template<typename T>
 class Blur {
 private:
-    ThreadPool *threadPool;
+    ThreadPool &threadPool = ThreadPool::shared();
 
-protected:
-    SharedValues *sharedValues;
-public:
+    /**
+     * Splits [0, count) into one inclusive range per available thread, runs them on the pool and
+     * waits for all of them.
+     */
+    void runOnThreadPool(const int count, const function<void(int, int)> &work) {
+        const long threads = sharedValues->availableThreads;
+        const int worksCount = count / threads;
 
-    virtual void processingRow(T *imagePixels, const int startRow, const int endRow) = 0;
+        std::vector<std::future<void>> futures;
 
-    virtual void processingColumn(T *imagePixels, const int startColumn, const int endColumn) = 0;
+        for (int i = 0; i < threads; i++) {
+            int start = i * worksCount;
+            int end = (i + 1) * worksCount - 1;
+            if (i == threads - 1) end = count - 1;
 
-    ~Blur() {
-        delete threadPool;
-        delete sharedValues;
+            futures.emplace_back(threadPool.enqueueJob([&work, start, end] { work(start, end); }));
+        }
+
+        for (future<void> &func: futures) {
+            func.wait();
+        }
     }
 
-    void onDestroy() {
-        delete sharedValues;
+protected:
+    // Number of adjacent columns the vertical pass walks down together. 16 ABGR pixels fill a 64-byte cache line.
+    static constexpr int COLUMN_BLOCK = 16;
+
+    // Per-column running sums of the scalar kernels.
+    struct ChannelSums {
+        long red = 0;
+        long green = 0;
+        long blue = 0;
+        // Only summed by the ABGR kernels in AlphaMode::PREMULTIPLIED.
+        long alpha = 0;
+    };
+
+    SharedValues *sharedValues = nullptr;
+
+    // Row strides, in pixels, of the buffer given to blur() and of the one the row and column passes
+    // walk, which is that buffer or resizedPixels. Set by blur() before it hands out the passes.
+    int srcStride = 0;
+    int passStride = 0;
+
+    // Target-sized working copy of the source, used only when sharedValues->isResized.
+    vector<T> resizedPixels;
+
+    // For each target column/row, the first source column/row of its box. One extra trailing entry
+    // holds the source size, so the box of index i is [downscaleX[i], downscaleX[i + 1]).
+    vector<int> downscaleX;
+    vector<int> downscaleY;
+
+    // For each source column, the left target column to sample and the 8-bit weight of the right one.
+    vector<int> upscaleX;
+    vector<unsigned short> upscaleWeightX;
+
+    /**
+     * Position of source index i in the target grid, sampling pixel centers, in 24.8 fixed point.
+     */
+    static int upscalePosition(const int i, const int srcSize, const int targetSize) {
+        const long long position = ((2LL * i + 1) * targetSize * 256) / (2LL * srcSize) - 128;
+        return (int) min(max(position, 0LL), (targetSize - 1) * 256LL);
     }
 
-    void blur(T *imagePixels) {
-        const int widthMax = sharedValues->widthMax;
-        const int heightMax = sharedValues->heightMax;
-        const long threads = sharedValues->availableThreads;
+public:
 
-        const int rowWorksCount = sharedValues->targetHeight / threads;
-        const int columnWorksCount = sharedValues->targetWidth / threads;
+    virtual void processingRow(T *imagePixels, const int startRow, const int endRow) = 0;
 
-        vector<function<void()>> rowWorks;
-        vector<function<void()>> columnWorks;
+    virtual void processingColumn(T *imagePixels, const int startColumn, const int endColumn) = 0;
 
-        for (int i = 0; i < threads; i++) {
-            int startRow = i * rowWorksCount;
-            int endRow = (i + 1) * rowWorksCount - 1;
-            if (i == threads - 1) endRow = heightMax;
+    // Box-filters the source rows covered by target rows [startRow, endRow] into resizedPixels.
+    virtual void processingDownscale(const T *imagePixels, const int startRow, const int endRow) = 0;
 
-            rowWorks.emplace_back(
-                    [imagePixels, startRow, endRow, this] { return processingRow(imagePixels, startRow, endRow); });
+    // Bilinearly samples resizedPixels back into source rows [startRow, endRow].
+    virtual void processingUpscale(T *imagePixels, const int startRow, const int endRow) = 0;
 
-            int startColumn = i * columnWorksCount;
-            int endColumn = (i + 1) * columnWorksCount - 1;
-            if (i == threads - 1) endColumn = widthMax;
+    virtual ~Blur() {
+        delete sharedValues;
+    }
 
-            columnWorks.emplace_back(
-                    [imagePixels, startColumn, endColumn, this] { return processingColumn(imagePixels, startColumn, endColumn); });
-        }
+    // The shared thread pool outlives this instance, only the per-size state is released here.
+    void onDestroy() {
+        delete sharedValues;
+        sharedValues = nullptr;
+        vector<T>().swap(resizedPixels);
+    }
 
-        std::vector<std::future<void>> futures;
+    // True when the last prepare() was for a source of this size and onDestroy() has not run since.
+    bool isPreparedFor(const int srcWidth, const int srcHeight) const {
+        return sharedValues != nullptr && sharedValues->srcWidth == srcWidth && sharedValues->srcHeight == srcHeight;
+    }
 
-        for (function<void()> &row: rowWorks) {
-            futures.emplace_back(threadPool->enqueueJob(row));
-        }
+    void blur(T *imagePixels) {
+        if (sharedValues != nullptr) blur(imagePixels, sharedValues->srcWidth);
+    }
 
-        for (future<void> &func: futures) {
-            func.wait();
+    /**
+     * Blurs a source whose rows are stride pixels apart, stride >= the width it was prepared for.
+     * Only the pixels of the source are read and written, the padding of the rows is left alone.
+     */
+    void blur(T *imagePixels, const int stride) {
+        if (sharedValues == nullptr) return;
+
+        T *pixels = imagePixels;
+        srcStride = stride;
+        passStride = sharedValues->isResized ? sharedValues->targetWidth : stride;
+
+        if (sharedValues->isResized) {
+            runOnThreadPool(sharedValues->targetHeight,
+                            [imagePixels, this](int start, int end) { processingDownscale(imagePixels, start, end); });
+            pixels = resizedPixels.data();
         }
 
-        for (function<void()> &column: columnWorks) {
-            futures.emplace_back(threadPool->enqueueJob(column));
-        }
+        runOnThreadPool(sharedValues->targetHeight, [pixels, this](int start, int end) { processingRow(pixels, start, end); });
+        runOnThreadPool(sharedValues->targetWidth, [pixels, this](int start, int end) { processingColumn(pixels, start, end); });
 
-        for (future<void> &func: futures) {
-            func.wait();
+        if (sharedValues->isResized) {
+            runOnThreadPool(sharedValues->srcHeight,
+                            [imagePixels, this](int start, int end) { processingUpscale(imagePixels, start, end); });
         }
     }
 
-    SharedValues *prepare(const int srcWidth, const int srcHeight, const int radius, const double resizeRatio) {
+    SharedValues *prepare(const int srcWidth, const int srcHeight, const int radius, const double resizeRatio,
+                          const AlphaMode alphaMode = AlphaMode::OPAQUE) {
         const bool resize = resizeRatio > 1.0;
-        int targetWidth = resize ? (int) (srcWidth / resizeRatio) : srcWidth;
-        int targetHeight = resize ? (int) (srcHeight / resizeRatio) : srcHeight;
+        int targetWidth = srcWidth;
+        int targetHeight = srcHeight;
 
-        if (targetWidth % 2 != 0) targetWidth--;
-        if (targetHeight % 2 != 0) targetHeight--;
+        // Without resizing we blur the caller's buffer in place, so the target must keep its stride.
+        if (resize) {
+            targetWidth = max(2, (int) (srcWidth / resizeRatio));
+            targetHeight = max(2, (int) (srcHeight / resizeRatio));
+
+            if (targetWidth % 2 != 0) targetWidth--;
+            if (targetHeight % 2 != 0) targetHeight--;
+        }
 
         const int widthMax = targetWidth - 1;
         const int heightMax = targetHeight - 1;
         const int newRadius = radius % 2 == 0 ? radius + 1 : radius;
 
 
-        long threads = sysconf(_SC_NPROCESSORS_ONLN);
-        threadPool = new ThreadPool(threads);
+        // Never split the work into more slices than there are rows or columns to hand out.
+        const long threads = max(1L, min((long) threadPool.threadsCount(), (long) min(targetWidth, targetHeight)));
         LOGD("threads : %ld", threads);
 
+        if (resize) {
+            resizedPixels.resize((size_t) targetWidth * targetHeight);
+
+            downscaleX.resize(targetWidth + 1);
+            for (int x = 0; x <= targetWidth; x++) downscaleX[x] = (int) ((long long) x * srcWidth / targetWidth);
+            downscaleY.resize(targetHeight + 1);
+            for (int y = 0; y <= targetHeight; y++) downscaleY[y] = (int) ((long long) y * srcHeight / targetHeight);
+
+            upscaleX.resize(srcWidth);
+            upscaleWeightX.resize(srcWidth);
+            for (int x = 0; x < srcWidth; x++) {
+                const int position = upscalePosition(x, srcWidth, targetWidth);
+                upscaleX[x] = position >> 8;
+                upscaleWeightX[x] = position & 0xff;
+            }
+        } else {
+            vector<T>().swap(resizedPixels);
+        }
+
+        delete sharedValues;
         sharedValues = new SharedValues{widthMax, heightMax, newRadius * 2 + 1, MUL_TABLE[newRadius], SHR_TABLE[newRadius],
-                                        targetWidth, targetHeight, newRadius, threads, resize};
+                                        targetWidth, targetHeight, newRadius, threads, resize, srcWidth, srcHeight,
+                                        alphaMode};
         return sharedValues;
     }
 };
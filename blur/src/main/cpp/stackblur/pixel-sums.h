@@ -0,0 +1,111 @@
+//
+// Created by jesp on 2023-07-12.
+//
+
+#ifndef TESTBED_PIXEL_SUMS_H
+#define TESTBED_PIXEL_SUMS_H
+
+#if defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+#define STACKBLUR_HAS_SIMD
+
+#elif defined(__SSE4_1__)
+
+#include <smmintrin.h>
+
+#define STACKBLUR_HAS_SIMD
+
+#endif
+
+#ifdef STACKBLUR_HAS_SIMD
+
+/**
+ * The four channel sums of an ABGR8888 pixel kept in the 32-bit lanes of one vector register,
+ * lane n holding byte n of the pixel. Lets the StackBlur kernels do one add instead of one per channel.
+ *
+ * 32 bits are enough for every radius: the weights of a stack add up to (radius + 1)^2, and
+ * 255 * (radius + 1)^2 * MUL_TABLE[radius] stays below 2^32 for the whole table.
+ */
+class PixelSums {
+private:
+#if defined(__ARM_NEON)
+    uint32x4_t lanes;
+#else
+    __m128i lanes;
+#endif
+
+public:
+#if defined(__ARM_NEON)
+
+    PixelSums() : lanes(vdupq_n_u32(0)) {}
+
+    explicit PixelSums(const unsigned int pixel) :
+            lanes(vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(pixel)))))) {}
+
+    PixelSums(const uint32x4_t lanes) : lanes(lanes) {}
+
+    PixelSums &operator+=(const PixelSums &other) {
+        lanes = vaddq_u32(lanes, other.lanes);
+        return *this;
+    }
+
+    PixelSums &operator-=(const PixelSums &other) {
+        lanes = vsubq_u32(lanes, other.lanes);
+        return *this;
+    }
+
+    PixelSums operator*(const unsigned int multiplier) const {
+        return vmulq_n_u32(lanes, multiplier);
+    }
+
+    /**
+     * Computes (sum * multiplySum) >> shiftSum for each lane and narrows the lanes back to the bytes of
+     * a pixel. Narrowing keeps the low byte, which matches the channel masks of the scalar kernels.
+     */
+    unsigned int toPixel(const unsigned int multiplySum, const int shiftSum) const {
+        const uint32x4_t shifted = vshlq_u32(vmulq_n_u32(lanes, multiplySum), vdupq_n_s32(-shiftSum));
+        const uint16x4_t narrow = vmovn_u32(shifted);
+        return vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(narrow, narrow))), 0);
+    }
+
+#else
+
+    PixelSums() : lanes(_mm_setzero_si128()) {}
+
+    explicit PixelSums(const unsigned int pixel) : lanes(_mm_cvtepu8_epi32(_mm_cvtsi32_si128((int) pixel))) {}
+
+    PixelSums(const __m128i lanes) : lanes(lanes) {}
+
+    PixelSums &operator+=(const PixelSums &other) {
+        lanes = _mm_add_epi32(lanes, other.lanes);
+        return *this;
+    }
+
+    PixelSums &operator-=(const PixelSums &other) {
+        lanes = _mm_sub_epi32(lanes, other.lanes);
+        return *this;
+    }
+
+    PixelSums operator*(const unsigned int multiplier) const {
+        return _mm_mullo_epi32(lanes, _mm_set1_epi32((int) multiplier));
+    }
+
+    /**
+     * Computes (sum * multiplySum) >> shiftSum for each lane and narrows the lanes back to the bytes of
+     * a pixel. Narrowing keeps the low byte, which matches the channel masks of the scalar kernels.
+     */
+    unsigned int toPixel(const unsigned int multiplySum, const int shiftSum) const {
+        const __m128i shifted = _mm_srl_epi32(_mm_mullo_epi32(lanes, _mm_set1_epi32((int) multiplySum)),
+                                              _mm_cvtsi32_si128(shiftSum));
+        const __m128i lowBytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        return (unsigned int) _mm_cvtsi128_si32(_mm_shuffle_epi8(shifted, lowBytes));
+    }
+
+#endif
+};
+
+#endif // STACKBLUR_HAS_SIMD
+
+#endif //TESTBED_PIXEL_SUMS_H
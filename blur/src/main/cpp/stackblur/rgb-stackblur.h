@@ -0,0 +1,361 @@
+//
+// Created by jesp on 2023-07-05.
+//
+
+#ifndef TESTBED_RGB_STACKBLUR_H
+#define TESTBED_RGB_STACKBLUR_H
+
+#include "blur.h"
+
+class RGBStackBlur : public Blur<unsigned short> {
+
+public:
+
+    void processingRow(unsigned short *imagePixels, const int startRow, const int endRow) override {
+        long sumRed, sumGreen, sumBlue;
+        long sumInputRed, sumInputGreen, sumInputBlue;
+        long sumOutputRed, sumOutputGreen, sumOutputBlue;
+        int startPixelIndex, inPixelIndex, outputPixelIndex;
+        int stackStart, stackPointer, stackIndex;
+        int colOffset;
+
+        short red, green, blue;
+        int multiplier;
+
+        const int widthMax = sharedValues->widthMax;
+        const int blurRadius = sharedValues->blurRadius;
+        const int targetWidth = sharedValues->targetWidth;
+        const int divisor = sharedValues->divisor;
+        const int multiplySum = sharedValues->multiplySum;
+        const int shiftSum = sharedValues->shiftSum;
+
+        short blurStack[divisor];
+        short pixel;
+
+
+        for (int row = startRow; row <= endRow; row++) {
+            sumRed = sumGreen = sumBlue = sumInputRed = sumInputGreen = sumInputBlue = sumOutputRed = sumOutputGreen = sumOutputBlue = 0;
+            startPixelIndex = row * passStride;
+            inPixelIndex = startPixelIndex;
+            stackIndex = blurRadius;
+
+            for (int rad = 0; rad <= blurRadius; rad++) {
+                stackIndex = rad;
+                pixel = imagePixels[startPixelIndex];
+                blurStack[stackIndex] = pixel;
+
+                red = ((pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                green = ((pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                blue = (pixel bitand RGB_BLUE_MASK);
+
+                multiplier = rad + 1;
+                sumRed += red * multiplier;
+                sumGreen += green * multiplier;
+                sumBlue += blue * multiplier;
+
+                sumOutputRed += red;
+                sumOutputGreen += green;
+                sumOutputBlue += blue;
+
+                if (rad >= 1) {
+                    if (rad <= widthMax) inPixelIndex++;
+                    stackIndex = rad + blurRadius;
+
+                    pixel = imagePixels[inPixelIndex];
+                    blurStack[stackIndex] = pixel;
+
+                    multiplier = blurRadius + 1 - rad;
+
+                    red = ((pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                    green = ((pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                    blue = (pixel bitand RGB_BLUE_MASK);
+
+                    sumRed += red * multiplier;
+                    sumGreen += green * multiplier;
+                    sumBlue += blue * multiplier;
+
+                    sumInputRed += red;
+                    sumInputGreen += green;
+                    sumInputBlue += blue;
+                }
+            }
+
+            stackStart = blurRadius;
+            stackPointer = blurRadius;
+            colOffset = blurRadius;
+            if (colOffset > widthMax) colOffset = widthMax;
+            inPixelIndex = colOffset + row * passStride;
+            outputPixelIndex = startPixelIndex;
+
+            for (int col = 0; col < targetWidth; col++) {
+                imagePixels[outputPixelIndex] =
+                        (short) (((((sumRed * multiplySum) >> shiftSum) bitand RGB_RED_MASK) << RGB_RED_SHIFT) bitor
+                                 ((((sumGreen * multiplySum) >> shiftSum) bitand RGB_GREEN_MASK) << RGB_GREEN_SHIFT) bitor
+                                 (((sumBlue * multiplySum) >> shiftSum) bitand RGB_BLUE_MASK));
+                outputPixelIndex++;
+                sumRed -= sumOutputRed;
+                sumGreen -= sumOutputGreen;
+                sumBlue -= sumOutputBlue;
+
+                stackStart = stackPointer + divisor - blurRadius;
+                if (stackStart >= divisor) stackStart -= divisor;
+                stackIndex = stackStart;
+
+                sumOutputRed -= ((blurStack[stackIndex] >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                sumOutputGreen -= ((blurStack[stackIndex] >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                sumOutputBlue -= (blurStack[stackIndex] bitand RGB_BLUE_MASK);
+
+                if (colOffset < widthMax) {
+                    inPixelIndex++;
+                    colOffset++;
+                }
+
+                pixel = imagePixels[inPixelIndex];
+
+                blurStack[stackIndex] = pixel;
+
+                red = ((pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                green = ((pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                blue = (pixel bitand RGB_BLUE_MASK);
+
+                sumInputRed += red;
+                sumInputGreen += green;
+                sumInputBlue += blue;
+
+                sumRed += sumInputRed;
+                sumGreen += sumInputGreen;
+                sumBlue += sumInputBlue;
+
+                if (++stackPointer >= divisor) stackPointer = 0;
+                stackIndex = stackPointer;
+
+                pixel = blurStack[stackIndex];
+
+                red = ((pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                green = ((pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                blue = (pixel bitand RGB_BLUE_MASK);
+
+                sumOutputRed += red;
+                sumOutputGreen += green;
+                sumOutputBlue += blue;
+
+                sumInputRed -= red;
+                sumInputGreen -= green;
+                sumInputBlue -= blue;
+            }
+        }
+    }
+
+    void processingColumn(unsigned short *imagePixels, const int startColumn, const int endColumn) override {
+        const int heightMax = sharedValues->heightMax;
+        const int blurRadius = sharedValues->blurRadius;
+        const int targetHeight = sharedValues->targetHeight;
+        const int divisor = sharedValues->divisor;
+        const int multiplySum = sharedValues->multiplySum;
+        const int shiftSum = sharedValues->shiftSum;
+
+        short red, green, blue;
+        unsigned short pixel;
+
+        // See ABGRStackBlur::processingColumn for the column blocking.
+        unsigned short blurStack[divisor * COLUMN_BLOCK];
+        ChannelSums sum[COLUMN_BLOCK], sumInput[COLUMN_BLOCK], sumOutput[COLUMN_BLOCK];
+
+        for (int blockStart = startColumn; blockStart <= endColumn; blockStart += COLUMN_BLOCK) {
+            const int blockWidth = min(COLUMN_BLOCK, endColumn - blockStart + 1);
+            unsigned short *blockPixels = imagePixels + blockStart;
+
+            for (int c = 0; c < blockWidth; c++) sum[c] = sumInput[c] = sumOutput[c] = ChannelSums();
+
+            int sourceRow = 0;
+
+            for (int rad = 0; rad <= blurRadius; rad++) {
+                const unsigned short *sourcePixels = blockPixels + sourceRow * passStride;
+                unsigned short *stackRow = blurStack + rad * COLUMN_BLOCK;
+                int multiplier = rad + 1;
+
+                for (int c = 0; c < blockWidth; c++) {
+                    pixel = sourcePixels[c];
+                    stackRow[c] = pixel;
+
+                    red = ((pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                    green = ((pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                    blue = (pixel bitand RGB_BLUE_MASK);
+
+                    sum[c].red += red * multiplier;
+                    sum[c].green += green * multiplier;
+                    sum[c].blue += blue * multiplier;
+
+                    sumOutput[c].red += red;
+                    sumOutput[c].green += green;
+                    sumOutput[c].blue += blue;
+                }
+
+                if (rad >= 1) {
+                    if (rad <= heightMax) sourceRow++;
+                    const unsigned short *inRow = blockPixels + sourceRow * passStride;
+                    stackRow = blurStack + (rad + blurRadius) * COLUMN_BLOCK;
+                    multiplier = blurRadius + 1 - rad;
+
+                    for (int c = 0; c < blockWidth; c++) {
+                        pixel = inRow[c];
+                        stackRow[c] = pixel;
+
+                        red = ((pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                        green = ((pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                        blue = (pixel bitand RGB_BLUE_MASK);
+
+                        sum[c].red += red * multiplier;
+                        sum[c].green += green * multiplier;
+                        sum[c].blue += blue * multiplier;
+
+                        sumInput[c].red += red;
+                        sumInput[c].green += green;
+                        sumInput[c].blue += blue;
+                    }
+                }
+            }
+
+            int stackPointer = blurRadius;
+            int yOffset = min(blurRadius, heightMax);
+
+            for (int y = 0; y < targetHeight; y++) {
+                unsigned short *outRow = blockPixels + y * passStride;
+
+                for (int c = 0; c < blockWidth; c++) {
+                    outRow[c] = (short) (((((sum[c].red * multiplySum) >> shiftSum) bitand RGB_RED_MASK) << RGB_RED_SHIFT) bitor (
+                            (((sum[c].green * multiplySum) >> shiftSum) bitand RGB_GREEN_MASK) << RGB_GREEN_SHIFT) bitor
+                                         (((sum[c].blue * multiplySum) >> shiftSum) bitand RGB_BLUE_MASK));
+
+                    sum[c].red -= sumOutput[c].red;
+                    sum[c].green -= sumOutput[c].green;
+                    sum[c].blue -= sumOutput[c].blue;
+                }
+
+                int stackStart = stackPointer + divisor - blurRadius;
+                if (stackStart >= divisor) stackStart -= divisor;
+                unsigned short *stackRow = blurStack + stackStart * COLUMN_BLOCK;
+
+                if (yOffset < heightMax) yOffset++;
+                const unsigned short *inRow = blockPixels + yOffset * passStride;
+
+                for (int c = 0; c < blockWidth; c++) {
+                    pixel = stackRow[c];
+
+                    sumOutput[c].red -= ((pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                    sumOutput[c].green -= ((pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                    sumOutput[c].blue -= (pixel bitand RGB_BLUE_MASK);
+
+                    pixel = inRow[c];
+                    stackRow[c] = pixel;
+
+                    sumInput[c].red += ((pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                    sumInput[c].green += ((pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                    sumInput[c].blue += (pixel bitand RGB_BLUE_MASK);
+
+                    sum[c].red += sumInput[c].red;
+                    sum[c].green += sumInput[c].green;
+                    sum[c].blue += sumInput[c].blue;
+                }
+
+                if (++stackPointer >= divisor) stackPointer = 0;
+                stackRow = blurStack + stackPointer * COLUMN_BLOCK;
+
+                for (int c = 0; c < blockWidth; c++) {
+                    pixel = stackRow[c];
+
+                    red = ((pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK);
+                    green = ((pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK);
+                    blue = (pixel bitand RGB_BLUE_MASK);
+
+                    sumOutput[c].red += red;
+                    sumOutput[c].green += green;
+                    sumOutput[c].blue += blue;
+
+                    sumInput[c].red -= red;
+                    sumInput[c].green -= green;
+                    sumInput[c].blue -= blue;
+                }
+            }
+        }
+    }
+
+    void processingDownscale(const unsigned short *imagePixels, const int startRow, const int endRow) override {
+        const int targetWidth = sharedValues->targetWidth;
+
+        for (int row = startRow; row <= endRow; row++) {
+            const int firstY = downscaleY[row];
+            const int lastY = max(downscaleY[row + 1], firstY + 1);
+            unsigned short *outPixel = resizedPixels.data() + row * targetWidth;
+
+            for (int col = 0; col < targetWidth; col++) {
+                const int firstX = downscaleX[col];
+                const int lastX = max(downscaleX[col + 1], firstX + 1);
+                unsigned int sumRed = 0, sumGreen = 0, sumBlue = 0;
+
+                for (int y = firstY; y < lastY; y++) {
+                    const unsigned short *inPixel = imagePixels + y * srcStride;
+                    for (int x = firstX; x < lastX; x++) {
+                        const unsigned short pixel = inPixel[x];
+                        sumRed += (pixel >> RGB_RED_SHIFT) bitand RGB_RED_MASK;
+                        sumGreen += (pixel >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK;
+                        sumBlue += pixel bitand RGB_BLUE_MASK;
+                    }
+                }
+
+                const unsigned int area = (lastX - firstX) * (lastY - firstY);
+                const unsigned int half = area / 2;
+                *outPixel++ = (unsigned short) ((((sumRed + half) / area) << RGB_RED_SHIFT) bitor
+                                                (((sumGreen + half) / area) << RGB_GREEN_SHIFT) bitor
+                                                ((sumBlue + half) / area));
+            }
+        }
+    }
+
+    void processingUpscale(unsigned short *imagePixels, const int startRow, const int endRow) override {
+        const int srcWidth = sharedValues->srcWidth;
+        const int srcHeight = sharedValues->srcHeight;
+        const int targetWidth = sharedValues->targetWidth;
+        const int targetHeight = sharedValues->targetHeight;
+        const int widthMax = sharedValues->widthMax;
+        const int heightMax = sharedValues->heightMax;
+
+        for (int row = startRow; row <= endRow; row++) {
+            const int position = upscalePosition(row, srcHeight, targetHeight);
+            const int weightY = position bitand 0xff;
+            const unsigned short *topRow = resizedPixels.data() + (position >> 8) * targetWidth;
+            const unsigned short *bottomRow = resizedPixels.data() + min((position >> 8) + 1, heightMax) * targetWidth;
+            unsigned short *outPixel = imagePixels + row * srcStride;
+
+            for (int col = 0; col < srcWidth; col++) {
+                const int left = upscaleX[col];
+                const int right = min(left + 1, widthMax);
+                const int weightX = upscaleWeightX[col];
+
+                // Bilinear weights of the four neighbours, summing to 65536.
+                const int topLeft = (256 - weightX) * (256 - weightY);
+                const int topRight = weightX * (256 - weightY);
+                const int bottomLeft = (256 - weightX) * weightY;
+                const int bottomRight = weightX * weightY;
+
+                const unsigned short p0 = topRow[left], p1 = topRow[right], p2 = bottomRow[left], p3 = bottomRow[right];
+
+                const int red = (((p0 >> RGB_RED_SHIFT) bitand RGB_RED_MASK) * topLeft + ((p1 >> RGB_RED_SHIFT) bitand RGB_RED_MASK) * topRight +
+                                 ((p2 >> RGB_RED_SHIFT) bitand RGB_RED_MASK) * bottomLeft +
+                                 ((p3 >> RGB_RED_SHIFT) bitand RGB_RED_MASK) * bottomRight) >> 16;
+                const int green = (((p0 >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK) * topLeft +
+                                   ((p1 >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK) * topRight +
+                                   ((p2 >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK) * bottomLeft +
+                                   ((p3 >> RGB_GREEN_SHIFT) bitand RGB_GREEN_MASK) * bottomRight) >> 16;
+                const int blue = ((p0 bitand RGB_BLUE_MASK) * topLeft + (p1 bitand RGB_BLUE_MASK) * topRight +
+                                  (p2 bitand RGB_BLUE_MASK) * bottomLeft + (p3 bitand RGB_BLUE_MASK) * bottomRight) >> 16;
+
+                outPixel[col] = (unsigned short) ((red << RGB_RED_SHIFT) bitor (green << RGB_GREEN_SHIFT) bitor blue);
+            }
+        }
+    }
+
+};
+
+
+#endif //TESTBED_RGB_STACKBLUR_H
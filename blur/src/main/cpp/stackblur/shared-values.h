@@ -5,6 +5,19 @@
 #ifndef TESTBED_SHARED_VALUES_H
 #define TESTBED_SHARED_VALUES_H
 
+/**
+ * How the alpha channel of ARGB8888 pixels is treated. RGB565 has no alpha and ignores it.
+ *
+ * OPAQUE blurs the color channels only and keeps the original alpha of every pixel.
+ * PREMULTIPLIED blurs all four channels. Android bitmaps store premultiplied colors, and a weighted
+ * average of premultiplied pixels is itself premultiplied, so translucent edges fade out instead of
+ * turning into dark halos.
+ */
+enum class AlphaMode {
+    OPAQUE,
+    PREMULTIPLIED
+};
+
 struct SharedValues {
     const int widthMax;
     const int heightMax;
@@ -16,9 +29,13 @@ struct SharedValues {
     const int blurRadius;
     const long availableThreads;
     const bool isResized;
+    const int srcWidth;
+    const int srcHeight;
+    const AlphaMode alphaMode;
 
     SharedValues(int widthMax, int heightMax, int divisor, unsigned short multiplySum, unsigned char shiftSum, int targetWidth, int targetHeight, int
-    blurRadius, long availableThreads, bool isResized) :
+    blurRadius, long availableThreads, bool isResized, int srcWidth, int srcHeight,
+                 AlphaMode alphaMode) :
             widthMax(widthMax),
             heightMax(heightMax),
             divisor(divisor),
@@ -28,7 +45,10 @@ struct SharedValues {
             targetHeight(targetHeight),
             blurRadius(blurRadius),
             availableThreads(availableThreads),
-            isResized(isResized) {
+            isResized(isResized),
+            srcWidth(srcWidth),
+            srcHeight(srcHeight),
+            alphaMode(alphaMode) {
     }
 };
 
@@ -49,9 +69,11 @@ struct SharedValues {
 #define ARGB_BLUE_MASK 0xff
 #define ARGB_GREEN_MASK 0xff
 #define ARGB_RED_MASK 0xff
+#define ARGB_ALPHA_MASK 0xff
 
 #define ARGB_RED_SHIFT 16
 #define ARGB_GREEN_SHIFT 8
+#define ARGB_ALPHA_SHIFT 24
 
 
 static const unsigned short MUL_TABLE[] = {512, 512, 456, 512, 328, 456, 335, 512, 405, 328, 271, 456, 388, 335, 292, 512,
@@ -3,3 +3,10 @@
 //
 
 #include "threadpool.h"
+#include <algorithm>
+
+ThreadPool &ThreadPool::shared() {
+    // Function-local static: thread-safe lazy construction, joined at library unload.
+    static ThreadPool pool(std::clamp(sysconf(_SC_NPROCESSORS_ONLN), 1L, MAX_THREADS));
+    return pool;
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstdint>
+
+#include "RenderScriptToolkit.h"
+#include "Stages.h"
+#include "TaskProcessor.h"
+#include "Utils.h"
+
+namespace renderscript {
+
+#define LOG_TAG "renderscript.toolkit.Blend"
+
+    using BlendingMode = RenderScriptToolkit::BlendingMode;
+
+/**
+ * Blends a source into a destination, based on the mode.
+ */
+    class BlendTask : public Task {
+        // The type of blending to do.
+        BlendingMode mMode;
+        // The input we're blending.
+        const uchar4 *mIn;
+        // The destination, used both for input and output.
+        uchar4 *mOut;
+
+        // Process a 2D tile of the overall work. threadIndex identifies which thread does the work.
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "Blend"; }
+
+        BlendTask(BlendingMode mode, const uint8_t *in, uint8_t *out, size_t sizeX, size_t sizeY,
+                  const Restriction *restriction)
+                : Task{sizeX, sizeY, 4, true, restriction},
+                  mMode{mode},
+                  mIn{reinterpret_cast<const uchar4 *>(in)},
+                  mOut{reinterpret_cast<uchar4 *>(out)} {}
+    };
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+
+    using X86BlendKernel = void (*)(void *dst, const void *src, uint32_t count8);
+
+/**
+ * Returns the x86 kernel of the mode, or nullptr for the modes that don't have one.
+ */
+    static X86BlendKernel x86BlendKernel(const X86Kernels *kernels, BlendingMode mode) {
+        switch (mode) {
+            case BlendingMode::SRC_OVER:
+                return kernels->blendSrcOver;
+            case BlendingMode::DST_OVER:
+                return kernels->blendDstOver;
+            case BlendingMode::SRC_IN:
+                return kernels->blendSrcIn;
+            case BlendingMode::DST_IN:
+                return kernels->blendDstIn;
+            case BlendingMode::SRC_OUT:
+                return kernels->blendSrcOut;
+            case BlendingMode::DST_OUT:
+                return kernels->blendDstOut;
+            case BlendingMode::SRC_ATOP:
+                return kernels->blendSrcAtop;
+            case BlendingMode::DST_ATOP:
+                return kernels->blendDstAtop;
+            case BlendingMode::XOR:
+                return kernels->blendXor;
+            case BlendingMode::MULTIPLY:
+                return kernels->blendMultiply;
+            case BlendingMode::ADD:
+                return kernels->blendAdd;
+            case BlendingMode::SUBTRACT:
+                return kernels->blendSub;
+            default:
+                return nullptr;
+        }
+    }
+
+#endif
+
+// Convert vector to uchar4, clipping each value to 255.
+    template<typename TI>
+    static inline uchar4 convertClipped(TI amount) {
+        return uchar4{static_cast<uchar>(amount.x > 255 ? 255 : amount.x),
+                      static_cast<uchar>(amount.y > 255 ? 255 : amount.y),
+                      static_cast<uchar>(amount.z > 255 ? 255 : amount.z),
+                      static_cast<uchar>(amount.w > 255 ? 255 : amount.w)};
+    }
+
+    void blendRow(BlendingMode mode, const uchar4 *in, uchar4 *out, uint32_t length,
+                  const X86Kernels *x86Kernels) {
+        uint32_t x1 = 0;
+        uint32_t x2 = length;
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+        if (x86Kernels != nullptr) {
+            // The kernels blend blocks of 8 pixels. The scalar loops below finish the row.
+            X86BlendKernel kernel = x86BlendKernel(x86Kernels, mode);
+            if (kernel != nullptr && x2 - x1 >= 8) {
+                uint32_t len = (x2 - x1) >> 3;
+                kernel(out, in, len);
+                x1 += len << 3;
+                out += len << 3;
+                in += len << 3;
+            }
+        }
+#else
+        (void) x86Kernels;  // Avoid unused parameter warning.
+#endif
+
+        switch (mode) {
+            case BlendingMode::CLEAR:
+                for (; x1 < x2; x1++, out++) {
+                    *out = 0;
+                }
+                break;
+            case BlendingMode::SRC:
+                for (; x1 < x2; x1++, out++, in++) {
+                    *out = *in;
+                }
+                break;
+            // BlendingMode::DST is a NOP
+            case BlendingMode::DST:
+                break;
+            case BlendingMode::SRC_OVER:
+                for (; x1 < x2; x1++, out++, in++) {
+                    ushort4 in_s = convert<ushort4>(*in);
+                    ushort4 out_s = convert<ushort4>(*out);
+                    in_s = in_s + ((out_s * (ushort) (255 - in_s.w)) >> (ushort) 8);
+                    *out = convertClipped(in_s);
+                }
+                break;
+            case BlendingMode::DST_OVER:
+                for (; x1 < x2; x1++, out++, in++) {
+                    ushort4 in_s = convert<ushort4>(*in);
+                    ushort4 out_s = convert<ushort4>(*out);
+                    in_s = out_s + ((in_s * (ushort) (255 - out_s.w)) >> (ushort) 8);
+                    *out = convertClipped(in_s);
+                }
+                break;
+            case BlendingMode::SRC_IN:
+                for (; x1 < x2; x1++, out++, in++) {
+                    int4 in_s = convert<int4>(*in);
+                    in_s = (in_s * (int) out->w) >> 8;
+                    *out = convertClipped(in_s);
+                }
+                break;
+            case BlendingMode::DST_IN:
+                for (; x1 < x2; x1++, out++, in++) {
+                    int4 out_s = convert<int4>(*out);
+                    out_s = (out_s * (int) in->w) >> 8;
+                    *out = convertClipped(out_s);
+                }
+                break;
+            case BlendingMode::SRC_OUT:
+                for (; x1 < x2; x1++, out++, in++) {
+                    int4 in_s = convert<int4>(*in);
+                    in_s = (in_s * (int) (255 - out->w)) >> 8;
+                    *out = convertClipped(in_s);
+                }
+                break;
+            case BlendingMode::DST_OUT:
+                for (; x1 < x2; x1++, out++, in++) {
+                    int4 out_s = convert<int4>(*out);
+                    out_s = (out_s * (int) (255 - in->w)) >> 8;
+                    *out = convertClipped(out_s);
+                }
+                break;
+            case BlendingMode::SRC_ATOP:
+                // The products are added with unsigned 16-bit saturation, like the SIMD kernels.
+                // That only matters for inputs that are not premultiplied.
+                for (; x1 < x2; x1++, out++, in++) {
+                    int4 in_s = convert<int4>(*in);
+                    int4 out_s = convert<int4>(*out);
+                    int4 sum = in_s * out_s.w + out_s * (255 - in_s.w);
+                    int4 result = clamp(sum, 0, 65535) >> 8;
+                    result.w = out_s.w;
+                    *out = convertClipped(result);
+                }
+                break;
+            case BlendingMode::DST_ATOP:
+                for (; x1 < x2; x1++, out++, in++) {
+                    int4 in_s = convert<int4>(*in);
+                    int4 out_s = convert<int4>(*out);
+                    int4 sum = out_s * in_s.w + in_s * (255 - out_s.w);
+                    int4 result = clamp(sum, 0, 65535) >> 8;
+                    result.w = in_s.w;
+                    *out = convertClipped(result);
+                }
+                break;
+            case BlendingMode::XOR:
+                for (; x1 < x2; x1++, out++, in++) {
+                    *out = *in ^ *out;
+                }
+                break;
+            case BlendingMode::MULTIPLY:
+                for (; x1 < x2; x1++, out++, in++) {
+                    *out = convertClipped((convert<uint4>(*in) * convert<uint4>(*out)) >> 8);
+                }
+                break;
+            case BlendingMode::ADD:
+                for (; x1 < x2; x1++, out++, in++) {
+                    *out = convertClipped(convert<uint4>(*in) + convert<uint4>(*out));
+                }
+                break;
+            case BlendingMode::SUBTRACT:
+                for (; x1 < x2; x1++, out++, in++) {
+                    int4 difference = convert<int4>(*out) - convert<int4>(*in);
+                    *out = convert<uchar4>(clamp(difference, 0, 255));
+                }
+                break;
+            default:
+                ALOGE("Called unimplemented value %d", (int) mode);
+                assert(false);
+        }
+    }
+
+    void BlendTask::processData(int /* threadIndex */, size_t startX, size_t startY, size_t endX,
+                                size_t endY) {
+#if defined(ARCH_X86_HAVE_SSSE3)
+        const X86Kernels *x86Kernels = mUsesSimd ? mX86Kernels : nullptr;
+#else
+        const X86Kernels *x86Kernels = nullptr;
+#endif
+        for (size_t y = startY; y < endY; y++) {
+            size_t offset = y * mSizeX + startX;
+            blendRow(mMode, mIn + offset, mOut + offset, endX - startX, x86Kernels);
+        }
+    }
+
+    void RenderScriptToolkit::blend(BlendingMode mode, const uint8_t *in, uint8_t *out,
+                                    size_t sizeX, size_t sizeY, const Restriction *restriction) {
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (!validRestriction(LOG_TAG, sizeX, sizeY, restriction)) {
+            return;
+        }
+#endif
+
+        BlendTask task(mode, in, out, sizeX, sizeY, restriction);
+        processor->doTask(&task);
+    }
+
+}  // namespace renderscript
@@ -14,10 +14,14 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
 #include "RenderScriptToolkit.h"
+#include "Stages.h"
 #include "TaskProcessor.h"
 #include "Utils.h"
 
@@ -65,6 +69,8 @@ namespace renderscript {
                          size_t endY) override;
 
     public:
+        const char *name() const override { return "Blur"; }
+
         BlurTask(const uint8_t *in, uint8_t *out, size_t sizeX, size_t sizeY, size_t vectorSize,
                  uint32_t threadCount, float radius, const Restriction *restriction)
                 : Task{sizeX, sizeY, vectorSize, false, restriction},
@@ -72,7 +78,7 @@ namespace renderscript {
                   outArray{out},
                   mScratch{threadCount},
                   mScratchSize{threadCount},
-                  mRadius{std::min(25.0f, radius)} {
+                  mRadius{std::min((float) kMaxBlurTaskRadius, radius)} {
             ComputeGaussianWeights();
         }
 
@@ -85,10 +91,7 @@ namespace renderscript {
         }
     };
 
-    void BlurTask::ComputeGaussianWeights() {
-        memset(mFp, 0, sizeof(mFp));
-        memset(mIp, 0, sizeof(mIp));
-
+    int computeGaussianWeights(float radius, float *fp, uint16_t *ip) {
         // Compute gaussian weights for the blur
         // e is the euler's number
         float e = 2.718281828459045f;
@@ -102,7 +105,7 @@ namespace renderscript {
         // The larger the radius gets, the more our gaussian blur
         // will resemble a box blur since with large sigma
         // the gaussian curve begins to lose its shape
-        float sigma = 0.4f * mRadius + 0.6f;
+        float sigma = 0.4f * radius + 0.6f;
 
         // Now compute the coefficients. We will store some redundant values to save
         // some math during the blur calculations precompute some values
@@ -112,19 +115,27 @@ namespace renderscript {
         float normalizeFactor = 0.0f;
         float floatR = 0.0f;
         int r;
-        mIradius = (float) ceil(mRadius) + 0.5f;
-        for (r = -mIradius; r <= mIradius; r++) {
+        const int iradius = (float) ceil(radius) + 0.5f;
+        for (r = -iradius; r <= iradius; r++) {
             floatR = (float) r;
-            mFp[r + mIradius] = coeff1 * powf(e, floatR * floatR * coeff2);
-            normalizeFactor += mFp[r + mIradius];
+            fp[r + iradius] = coeff1 * powf(e, floatR * floatR * coeff2);
+            normalizeFactor += fp[r + iradius];
         }
 
         // Now we need to normalize the weights because all our coefficients need to add up to one
         normalizeFactor = 1.0f / normalizeFactor;
-        for (r = -mIradius; r <= mIradius; r++) {
-            mFp[r + mIradius] *= normalizeFactor;
-            mIp[r + mIradius] = (uint16_t) (mFp[r + mIradius] * 65536.0f + 0.5f);
+        for (r = -iradius; r <= iradius; r++) {
+            fp[r + iradius] *= normalizeFactor;
+            ip[r + iradius] = (uint16_t) (fp[r + iradius] * 65536.0f + 0.5f);
         }
+        return iradius;
+    }
+
+    void BlurTask::ComputeGaussianWeights() {
+        memset(mFp, 0, sizeof(mFp));
+        memset(mIp, 0, sizeof(mIp));
+
+        mIradius = computeGaussianWeights(mRadius, mFp, mIp);
     }
 
 /**
@@ -522,23 +533,449 @@ namespace renderscript {
         }
     }
 
+// Number of cells the separable passes accumulate at once. The uint32 sums of a chunk of RGBA
+// cells take 4KB of stack.
+    static constexpr size_t kPassChunkCells = 256;
+
+// Fractional bits of the intermediate image of the separable blur. Both passes round the way
+// rsdIntrinsicBlurU4_K and rsdIntrinsicBlurU1_K do, so that every path gives the same result.
+    static constexpr int kPassFractionBits = 7;
+
+/**
+ * Rounds a vertical sum of uchar by 16.16 weights to the 8.7 fixed point of the intermediate.
+ */
+    static inline uint16_t narrowVerticalSum(uint32_t sum) {
+        return (uint16_t) std::min(65535u, (sum + (1u << (15 - kPassFractionBits))) >>
+                                                  (16 - kPassFractionBits));
+    }
+
+/**
+ * Rounds a horizontal sum of 8.7 values by 16.16 weights to a uchar, in two steps like the NEON
+ * kernels: first to 8.7, then to an integer.
+ */
+    static inline uchar narrowHorizontalSum(uint32_t sum) {
+        const uint32_t value = std::min(65535u, (sum + (1u << 15)) >> 16);
+        return (uchar) std::min(255u, (value + (1u << (kPassFractionBits - 1))) >> kPassFractionBits);
+    }
+
+/**
+ * Adds weight times each of the count values of in to the sums.
+ */
+    template<typename T>
+    static inline void accumulateWeighted(uint32_t *sums, const T *in, size_t count,
+                                          uint32_t weight) {
+        for (size_t i = 0; i < count; i++) {
+            sums[i] += in[i] * weight;
+        }
+    }
+
+/**
+ * First pass of the separable blur: blurs the image vertically into an intermediate image.
+ *
+ * The intermediate holds 8.7 fixed point values, which keeps most of the rounding of this pass out
+ * of the final result. It covers the columns [mMidStartX, mMidStartX + mMidSizeX), the columns of
+ * the output plus those within the radius of them, and the rows of the output.
+ */
+    class BlurVerticalPassTask : public Task {
+        const uchar *mIn;
+        uint16_t *mMid;
+        const size_t mMidStartX;
+        const size_t mMidSizeX;
+        const size_t mMidStartY;
+        // 16.16 fixed point weights, 2 * mIradius + 1 of them.
+        const uint16_t *mIp;
+        const int mIradius;
+
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "BlurVerticalPass"; }
+
+        BlurVerticalPassTask(const uint8_t *in, uint16_t *mid, size_t sizeX, size_t sizeY,
+                             size_t vectorSize, const uint16_t *ip, int iradius,
+                             const Restriction *midRestriction)
+                : Task{sizeX, sizeY, vectorSize, false, midRestriction},
+                  mIn{in},
+                  mMid{mid},
+                  mMidStartX{midRestriction->startX},
+                  mMidSizeX{midRestriction->endX - midRestriction->startX},
+                  mMidStartY{midRestriction->startY},
+                  mIp{ip},
+                  mIradius{iradius} {}
+    };
+
+    void BlurVerticalPassTask::processData(int /* threadIndex */, size_t startX, size_t startY,
+                                           size_t endX, size_t endY) {
+        uint32_t sums[kPassChunkCells * 4];
+
+        for (size_t y = startY; y < endY; y++) {
+#if defined(ARCH_X86_HAVE_SSSE3)
+            if (mUsesSimd) {
+                const uchar *rows[2 * kMaxBlurTaskRadius + 1];
+                for (int r = -mIradius; r <= mIradius; r++) {
+                    const int validY = clamp((int) y + r, 0, (int) mSizeY - 1);
+                    rows[r + mIradius] = mIn + (validY * mSizeX + startX) * mVectorSize;
+                }
+                mX86Kernels->blurVU(
+                        mMid + ((y - mMidStartY) * mMidSizeX + startX - mMidStartX) * mVectorSize,
+                        rows, mIp, 2 * mIradius + 1, (endX - startX) * mVectorSize);
+                continue;
+            }
+#endif
+            for (size_t chunkX = startX; chunkX < endX; chunkX += kPassChunkCells) {
+                const size_t count = (std::min(chunkX + kPassChunkCells, endX) - chunkX) * mVectorSize;
+                memset(sums, 0, count * sizeof(uint32_t));
+
+                // Walk the rows of the kernel; each one is a contiguous, vectorizable run.
+                for (int r = -mIradius; r <= mIradius; r++) {
+                    const int validY = clamp((int) y + r, 0, (int) mSizeY - 1);
+                    accumulateWeighted(sums, mIn + (validY * mSizeX + chunkX) * mVectorSize, count,
+                                       mIp[r + mIradius]);
+                }
+
+                uint16_t *mid = mMid + ((y - mMidStartY) * mMidSizeX + chunkX - mMidStartX) * mVectorSize;
+                for (size_t i = 0; i < count; i++) {
+                    mid[i] = narrowVerticalSum(sums[i]);
+                }
+            }
+        }
+    }
+
+/**
+ * Second pass of the separable blur: blurs the intermediate image of BlurVerticalPassTask
+ * horizontally into the output.
+ *
+ * The sums of 8.7 values by 16.16 weights fit in 32 bits: the weights add up to about 65536,
+ * and 65535 * 65536 < 2^32.
+ */
+    class BlurHorizontalPassTask : public Task {
+        const uint16_t *mMid;
+        uchar *mOut;
+        const size_t mMidStartX;
+        const size_t mMidSizeX;
+        const size_t mMidStartY;
+        const uint16_t *mIp;
+        const int mIradius;
+
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+        // Blurs the cell at x, clamping the kernel at the edges of the image.
+        void blurEdgeCell(const uint16_t *midRow, uchar *out, size_t x) const;
+
+    public:
+        const char *name() const override { return "BlurHorizontalPass"; }
+
+        BlurHorizontalPassTask(const uint16_t *mid, uint8_t *out, size_t sizeX, size_t sizeY,
+                               size_t vectorSize, const uint16_t *ip, int iradius,
+                               const Restriction *midRestriction, const Restriction *restriction)
+                : Task{sizeX, sizeY, vectorSize, false, restriction},
+                  mMid{mid},
+                  mOut{out},
+                  mMidStartX{midRestriction->startX},
+                  mMidSizeX{midRestriction->endX - midRestriction->startX},
+                  mMidStartY{midRestriction->startY},
+                  mIp{ip},
+                  mIradius{iradius} {}
+    };
+
+    void BlurHorizontalPassTask::blurEdgeCell(const uint16_t *midRow, uchar *out, size_t x) const {
+        uint32_t sums[4] = {0, 0, 0, 0};
+        for (int r = -mIradius; r <= mIradius; r++) {
+            const int validX = clamp((int) x + r, 0, (int) mSizeX - 1);
+            accumulateWeighted(sums, midRow + (validX - mMidStartX) * mVectorSize, mVectorSize,
+                               mIp[r + mIradius]);
+        }
+        for (size_t c = 0; c < mVectorSize; c++) {
+            out[c] = narrowHorizontalSum(sums[c]);
+        }
+    }
+
+    void BlurHorizontalPassTask::processData(int /* threadIndex */, size_t startX, size_t startY,
+                                             size_t endX, size_t endY) {
+        uint32_t sums[kPassChunkCells * 4];
+        // Cells whose kernel lies entirely inside the image.
+        const size_t interiorStartX = std::clamp<size_t>(mIradius, startX, endX);
+        const size_t interiorEndX =
+                std::clamp<size_t>(mSizeX > (size_t) mIradius ? mSizeX - mIradius : 0, interiorStartX, endX);
+
+        for (size_t y = startY; y < endY; y++) {
+            const uint16_t *midRow = mMid + (y - mMidStartY) * mMidSizeX * mVectorSize;
+            uchar *outRow = mOut + y * mSizeX * mVectorSize;
+
+            for (size_t x = startX; x < interiorStartX; x++) {
+                blurEdgeCell(midRow, outRow + x * mVectorSize, x);
+            }
+            size_t chunkStartX = interiorStartX;
+#if defined(ARCH_X86_HAVE_SSSE3)
+            if (mUsesSimd && interiorStartX < interiorEndX) {
+                mX86Kernels->blurHU(outRow + interiorStartX * mVectorSize,
+                                    midRow + (interiorStartX - mIradius - mMidStartX) * mVectorSize,
+                                    mVectorSize, mIp, 2 * mIradius + 1,
+                                    (interiorEndX - interiorStartX) * mVectorSize);
+                chunkStartX = interiorEndX;
+            }
+#endif
+            for (size_t chunkX = chunkStartX; chunkX < interiorEndX; chunkX += kPassChunkCells) {
+                const size_t count =
+                        (std::min(chunkX + kPassChunkCells, interiorEndX) - chunkX) * mVectorSize;
+                memset(sums, 0, count * sizeof(uint32_t));
+
+                // Same as the vertical pass, with the rows of the kernel replaced by shifted
+                // copies of this row.
+                const uint16_t *first = midRow + (chunkX - mIradius - mMidStartX) * mVectorSize;
+                for (int r = 0; r <= 2 * mIradius; r++) {
+                    accumulateWeighted(sums, first + r * mVectorSize, count, mIp[r]);
+                }
+
+                uchar *out = outRow + chunkX * mVectorSize;
+                for (size_t i = 0; i < count; i++) {
+                    out[i] = narrowHorizontalSum(sums[i]);
+                }
+            }
+            for (size_t x = interiorEndX; x < endX; x++) {
+                blurEdgeCell(midRow, outRow + x * mVectorSize, x);
+            }
+        }
+    }
+
+/**
+ * Box-filters an image into a copy whose dimensions are divided by an integer factor.
+ *
+ * Used for radii above kMaxBlurTaskRadius: each cell of the small image averages the block of
+ * input cells it covers. The blocks are spread over the whole input, so the last ones may be one
+ * cell wider or taller than the others.
+ */
+    class BlurDownscaleTask : public Task {
+        const uchar *mIn;
+        uchar *mOut;
+        const size_t mInSizeX;
+        const size_t mInSizeY;
+
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "BlurDownscale"; }
+
+        BlurDownscaleTask(const uint8_t *in, uint8_t *out, size_t inSizeX, size_t inSizeY,
+                          size_t outSizeX, size_t outSizeY, size_t vectorSize)
+                : Task{outSizeX, outSizeY, vectorSize, false, nullptr},
+                  mIn{in},
+                  mOut{out},
+                  mInSizeX{inSizeX},
+                  mInSizeY{inSizeY} {}
+    };
+
+    void BlurDownscaleTask::processData(int /* threadIndex */, size_t startX, size_t startY,
+                                        size_t endX, size_t endY) {
+        for (size_t y = startY; y < endY; y++) {
+            const size_t firstY = y * mInSizeY / mSizeY;
+            const size_t lastY = (y + 1) * mInSizeY / mSizeY;
+            uchar *out = mOut + (y * mSizeX + startX) * mVectorSize;
+
+            for (size_t x = startX; x < endX; x++) {
+                const size_t firstX = x * mInSizeX / mSizeX;
+                const size_t lastX = (x + 1) * mInSizeX / mSizeX;
+                const uint32_t area = (lastX - firstX) * (lastY - firstY);
+                uint32_t sum[4] = {0, 0, 0, 0};
+
+                for (size_t iy = firstY; iy < lastY; iy++) {
+                    const uchar *in = mIn + (iy * mInSizeX + firstX) * mVectorSize;
+                    for (size_t ix = firstX; ix < lastX; ix++) {
+                        for (size_t c = 0; c < mVectorSize; c++) {
+                            sum[c] += *in++;
+                        }
+                    }
+                }
+                for (size_t c = 0; c < mVectorSize; c++) {
+                    *out++ = (uchar) ((sum[c] + area / 2) / area);
+                }
+            }
+        }
+    }
+
+/**
+ * Bilinearly scales the blurred small image produced for large radii back to the full size.
+ *
+ * Cells are sampled at their centers, so the output is not shifted relative to the input. The
+ * restriction, if any, applies to the output only.
+ */
+    class BlurUpscaleTask : public Task {
+        const uchar *mIn;
+        uchar *mOut;
+        const size_t mInSizeX;
+        const size_t mInSizeY;
+
+        // For each output column, the left input column to sample and the 8-bit weight of the
+        // column to its right.
+        std::vector<uint32_t> mColumns;
+        std::vector<uint32_t> mColumnWeights;
+
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "BlurUpscale"; }
+
+        BlurUpscaleTask(const uint8_t *in, uint8_t *out, size_t inSizeX, size_t inSizeY,
+                        size_t outSizeX, size_t outSizeY, size_t vectorSize,
+                        const Restriction *restriction)
+                : Task{outSizeX, outSizeY, vectorSize, false, restriction},
+                  mIn{in},
+                  mOut{out},
+                  mInSizeX{inSizeX},
+                  mInSizeY{inSizeY},
+                  mColumns(outSizeX),
+                  mColumnWeights(outSizeX) {
+            for (size_t x = 0; x < outSizeX; x++) {
+                const uint32_t position = samplePosition(x, outSizeX, inSizeX);
+                mColumns[x] = position >> 8;
+                mColumnWeights[x] = position & 0xff;
+            }
+        }
+
+        /**
+         * Position of the center of output cell i in the input grid, in 24.8 fixed point, clamped
+         * to the first and last input cells.
+         */
+        static uint32_t samplePosition(size_t i, size_t outSize, size_t inSize) {
+            const int64_t position =
+                    (int64_t) ((2 * i + 1) * inSize * 256 / (2 * outSize)) - 128;
+            return (uint32_t) std::clamp(position, (int64_t) 0, (int64_t) (inSize - 1) * 256);
+        }
+    };
+
+    void BlurUpscaleTask::processData(int /* threadIndex */, size_t startX, size_t startY,
+                                      size_t endX, size_t endY) {
+        for (size_t y = startY; y < endY; y++) {
+            const uint32_t position = samplePosition(y, mSizeY, mInSizeY);
+            const uint32_t weightBottom = position & 0xff;
+            const uint32_t weightTop = 256 - weightBottom;
+            const size_t top = position >> 8;
+            const size_t bottom = std::min(top + 1, mInSizeY - 1);
+            const uchar *topRow = mIn + top * mInSizeX * mVectorSize;
+            const uchar *bottomRow = mIn + bottom * mInSizeX * mVectorSize;
+            uchar *out = mOut + (y * mSizeX + startX) * mVectorSize;
+
+            for (size_t x = startX; x < endX; x++) {
+                const size_t left = mColumns[x] * mVectorSize;
+                const size_t right = std::min<size_t>(mColumns[x] + 1, mInSizeX - 1) * mVectorSize;
+                const uint32_t weightRight = mColumnWeights[x];
+                const uint32_t weightLeft = 256 - weightRight;
+
+                for (size_t c = 0; c < mVectorSize; c++) {
+                    const uint32_t upper = topRow[left + c] * weightLeft + topRow[right + c] * weightRight;
+                    const uint32_t lower =
+                            bottomRow[left + c] * weightLeft + bottomRow[right + c] * weightRight;
+                    *out++ = (uchar) ((upper * weightTop + lower * weightBottom + (1 << 15)) >> 16);
+                }
+            }
+        }
+    }
+
+    bool RenderScriptToolkit::useSeparableBlur(size_t sizeX) {
+#if defined(ARCH_ARM_USE_INTRINSICS)
+        // The NEON kernels of BlurTask blur a row without the per-row vertical buffer, so they stay
+        // the faster choice until rows no longer fit in it.
+        return sizeX > 2048;
+#else
+        (void) sizeX;
+        return true;
+#endif
+    }
+
+    void RenderScriptToolkit::separableBlur(const uint8_t *in, uint8_t *out, size_t sizeX,
+                                            size_t sizeY, size_t vectorSize, float radius,
+                                            const Restriction *restriction) {
+        float fp[2 * kMaxBlurTaskRadius + 1];
+        uint16_t ip[2 * kMaxBlurTaskRadius + 1];
+        const int iradius = computeGaussianWeights(radius, fp, ip);
+
+        Restriction all{0, sizeX, 0, sizeY};
+        const Restriction &outArea = restriction ? *restriction : all;
+        // The horizontal pass reads up to iradius columns on either side of the output.
+        const Restriction midArea{outArea.startX > (size_t) iradius ? outArea.startX - iradius : 0,
+                                  std::min(outArea.endX + iradius, sizeX), outArea.startY,
+                                  outArea.endY};
+
+        // The intermediate is kept between calls, so blurring frames of the same size does not
+        // allocate. The two passes are separate tasks, hence the lock around both.
+        std::lock_guard<std::mutex> lock(blurIntermediateMutex);
+        const size_t midSize =
+                (midArea.endX - midArea.startX) * (midArea.endY - midArea.startY) * vectorSize;
+        if (blurIntermediate.size() < midSize) {
+            blurIntermediate.resize(midSize);
+        }
+
+        BlurVerticalPassTask vertical(in, blurIntermediate.data(), sizeX, sizeY, vectorSize, ip,
+                                      iradius, &midArea);
+        processor->doTask(&vertical);
+
+        BlurHorizontalPassTask horizontal(blurIntermediate.data(), out, sizeX, sizeY, vectorSize,
+                                          ip, iradius, &midArea, restriction);
+        processor->doTask(&horizontal);
+    }
+
     void RenderScriptToolkit::blur(const uint8_t *in, uint8_t *out, size_t sizeX, size_t sizeY,
                                    size_t vectorSize, int radius, const Restriction *restriction) {
 #ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
         if (!validRestriction(LOG_TAG, sizeX, sizeY, restriction)) {
             return;
         }
-        if (radius <= 0 || radius > 25) {
-            ALOGE("The radius should be between 1 and 25. %d provided.", radius);
+        if (radius <= 0) {
+            ALOGE("The radius should be greater than 0. %d provided.", radius);
         }
         if (vectorSize != 1 && vectorSize != 4) {
             ALOGE("The vectorSize should be 1 or 4. %zu provided.", vectorSize);
         }
 #endif
 
-        BlurTask task(in, out, sizeX, sizeY, vectorSize, processor->getNumberOfThreads(), radius,
-                      restriction);
-        processor->doTask(&task);
+        if (radius <= kMaxBlurTaskRadius) {
+            if (useSeparableBlur(sizeX)) {
+                separableBlur(in, out, sizeX, sizeY, vectorSize, (float) radius, restriction);
+                return;
+            }
+            BlurTask task(in, out, sizeX, sizeY, vectorSize, processor->getNumberOfThreads(), radius,
+                          restriction);
+            processor->doTask(&task);
+            return;
+        }
+
+        // The cost of BlurTask grows with the radius. Past its limit, blur a copy scaled down so
+        // that the radius fits, then scale the result back up. Downscaling and upscaling cost the
+        // same for every radius, and the blurring gets cheaper as the factor grows.
+        const size_t factor = divideRoundingUp(radius, kMaxBlurTaskRadius);
+        const size_t smallSizeX = std::max<size_t>(1, sizeX / factor);
+        const size_t smallSizeY = std::max<size_t>(1, sizeY / factor);
+
+        // Kept between calls like the intermediate of separableBlur(), the buffers only grow.
+        std::lock_guard<std::mutex> lock(blurSmallMutex);
+        const size_t smallSize = smallSizeX * smallSizeY * vectorSize;
+        if (blurSmall.size() < smallSize) {
+            blurSmall.resize(smallSize);
+            blurSmallBlurred.resize(smallSize);
+        }
+        uint8_t *small = blurSmall.data();
+        uint8_t *smallBlurred = blurSmallBlurred.data();
+
+        BlurDownscaleTask downscale(in, small, sizeX, sizeY, smallSizeX, smallSizeY, vectorSize);
+        processor->doTask(&downscale);
+
+        const float smallRadius = (float) radius / (float) factor;
+        if (useSeparableBlur(smallSizeX)) {
+            separableBlur(small, smallBlurred, smallSizeX, smallSizeY, vectorSize, smallRadius,
+                          nullptr);
+        } else {
+            BlurTask blur(small, smallBlurred, smallSizeX, smallSizeY, vectorSize,
+                          processor->getNumberOfThreads(), smallRadius, nullptr);
+            processor->doTask(&blur);
+        }
+
+        BlurUpscaleTask upscale(smallBlurred, out, smallSizeX, smallSizeY, sizeX, sizeY,
+                                vectorSize, restriction);
+        processor->doTask(&upscale);
     }
 
 }  // namespace renderscript
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdint>
+
+#include "RenderScriptToolkit.h"
+#include "TaskProcessor.h"
+#include "Utils.h"
+
+namespace renderscript {
+
+#define LOG_TAG "renderscript.toolkit.ColorMatrix"
+
+    using ElementType = RenderScriptToolkit::ElementType;
+
+/**
+ * The cheapest form of the matrix, from the most general to the most specialized. All the forms
+ * compute the same values, the specialized ones just skip the work whose result is known.
+ */
+    enum class MatrixShape {
+        // Each output channel depends on all the input channels.
+        k4x4,
+        // The alpha channel is copied unchanged.
+        k3x3,
+        // The alpha channel is copied unchanged and red, green and blue get the same value.
+        kDot,
+    };
+
+/**
+ * Multiplies each vector of the input by a 4x4 matrix, adds a vector and stores the result.
+ */
+    class ColorMatrixTask : public Task {
+        const uint8_t *mIn;
+        uint8_t *mOut;
+        size_t mInputVectorSize;
+        size_t mOutputVectorSize;
+        ElementType mInputType;
+        ElementType mOutputType;
+
+        // The rows of the matrix and the add vector, on the 0.0-1.0 scale of the channels.
+        float4 mFp[4];
+        float4 mFpa;
+        // The same in 8.8 fixed point, on the 0-255 scale of bytes. mIp holds the matrix as the
+        // x86 kernels expect it, mIpRows holds it as rows for the scalar loop.
+        short mIp[16];
+        int4 mIpRows[4];
+        int4 mIpa;
+        // True when both sides are bytes and the matrix fits the fixed-point representation.
+        bool mUsesIntegers = false;
+        // True when the x86 kernels can't overflow with this matrix, see updateCoefficients().
+        bool mKernelsFit = false;
+        MatrixShape mShape = MatrixShape::k4x4;
+
+        void updateCoefficients(const float *matrix, const float *addVector);
+
+        void classify();
+
+        void kernelIntegers(const uint8_t *in, uint8_t *out, size_t length);
+
+        template<typename TI, typename TO>
+        void kernelFloats(const uint8_t *in, uint8_t *out, size_t length);
+
+        // Process a 2D tile of the overall work. threadIndex identifies which thread does the work.
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "ColorMatrix"; }
+
+        ColorMatrixTask(const void *in, ElementType inputType, void *out, ElementType outputType,
+                        size_t inputVectorSize, size_t outputVectorSize, size_t sizeX,
+                        size_t sizeY, const float *matrix, const float *addVector,
+                        const Restriction *restriction)
+                : Task{sizeX, sizeY, outputVectorSize, true, restriction},
+                  mIn{reinterpret_cast<const uint8_t *>(in)},
+                  mOut{reinterpret_cast<uint8_t *>(out)},
+                  mInputVectorSize{inputVectorSize},
+                  mOutputVectorSize{outputVectorSize},
+                  mInputType{inputType},
+                  mOutputType{outputType} {
+            updateCoefficients(matrix, addVector);
+            classify();
+        }
+    };
+
+    void ColorMatrixTask::updateCoefficients(const float *matrix, const float *addVector) {
+        for (int i = 0; i < 4; i++) {
+            mFp[i] = float4{matrix[i * 4], matrix[i * 4 + 1], matrix[i * 4 + 2], matrix[i * 4 + 3]};
+            mFpa[i] = addVector == nullptr ? 0.f : addVector[i];
+        }
+
+        if (mInputType != ElementType::UCHAR || mOutputType != ElementType::UCHAR) {
+            return;
+        }
+        // The x86 kernels multiply 16 bit coefficients, and a larger add vector could overflow
+        // the 32 bit sums. Matrices that don't fit are computed with floats.
+        for (int i = 0; i < 16; i++) {
+            if (std::fabs(matrix[i] * 256.f) > 32767.f) {
+                return;
+            }
+        }
+        for (int i = 0; i < 4; i++) {
+            if (std::fabs(mFpa[i] * 255.f * 256.f) > (1 << 24)) {
+                return;
+            }
+        }
+        for (int i = 0; i < 16; i++) {
+            mIp[i] = static_cast<short>(std::lround(matrix[i] * 256.f));
+        }
+        for (int i = 0; i < 4; i++) {
+            mIpRows[i] = int4{mIp[i * 4], mIp[i * 4 + 1], mIp[i * 4 + 2], mIp[i * 4 + 3]};
+            mIpa[i] = static_cast<int>(std::lround(mFpa[i] * 255.f * 256.f));
+        }
+        mUsesIntegers = true;
+
+        // The kernels narrow the sums to 16 bits before clamping them to a byte. The sums of an
+        // output channel stay within range for any input when its positive and its negative
+        // coefficients each add up to at most 128. Other matrices use the scalar loop alone, so
+        // that a pixel doesn't depend on whether it falls in a block of four.
+        mKernelsFit = true;
+        for (int c = 0; c < 4; c++) {
+            int positive = 0;
+            int negative = 0;
+            for (int j = 0; j < 4; j++) {
+                (mIp[j * 4 + c] > 0 ? positive : negative) += mIp[j * 4 + c];
+            }
+            mKernelsFit = mKernelsFit && positive <= 128 * 256 && negative >= -128 * 256;
+        }
+    }
+
+    void ColorMatrixTask::classify() {
+        // The shape is decided on the coefficients that are actually used, so that a float that
+        // rounds to the identity still gets the cheaper kernel on the fixed-point path.
+        float m[16];
+        float a[4];
+        float one;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                m[i * 4 + j] = mUsesIntegers ? mIp[i * 4 + j] : mFp[i][j];
+            }
+            a[i] = mUsesIntegers ? mIpa[i] : mFpa[i];
+        }
+        one = mUsesIntegers ? 256.f : 1.f;
+
+        const bool copiesAlpha = m[3] == 0.f && m[7] == 0.f && m[11] == 0.f && m[15] == one &&
+                                 a[3] == 0.f;
+        if (!copiesAlpha) {
+            mShape = MatrixShape::k4x4;
+            return;
+        }
+        bool sameColor = a[0] == a[1] && a[0] == a[2];
+        for (int i = 0; i < 4; i++) {
+            sameColor = sameColor && m[i * 4] == m[i * 4 + 1] && m[i * 4] == m[i * 4 + 2];
+        }
+        mShape = sameColor ? MatrixShape::kDot : MatrixShape::k3x3;
+    }
+
+    void ColorMatrixTask::kernelIntegers(const uint8_t *in, uint8_t *out, size_t length) {
+        const size_t inStride = paddedSize(mInputVectorSize);
+        const size_t outStride = paddedSize(mOutputVectorSize);
+        size_t x1 = 0;
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+        // The kernels convert blocks of four RGBA pixels and have no add vector.
+        if (mUsesSimd && mKernelsFit && mInputVectorSize == 4 && mOutputVectorSize == 4 &&
+            mIpa[0] == 0 && mIpa[1] == 0 && mIpa[2] == 0 && mIpa[3] == 0 && length >= 4) {
+            uint32_t blocks = static_cast<uint32_t>(length >> 2);
+            switch (mShape) {
+                case MatrixShape::k4x4:
+                    mX86Kernels->colorMatrix4x4(out, in, mIp, blocks);
+                    break;
+                case MatrixShape::k3x3:
+                    mX86Kernels->colorMatrix3x3(out, in, mIp, blocks);
+                    break;
+                case MatrixShape::kDot:
+                    mX86Kernels->colorMatrixDot(out, in, mIp, blocks);
+                    break;
+            }
+            x1 = static_cast<size_t>(blocks) << 2;
+            in += x1 * 4;
+            out += x1 * 4;
+        }
+#endif
+
+        // Same arithmetic as the kernels: the sum is truncated, then clamped to a byte. The shape
+        // does not matter here, it only picks the kernel.
+        for (; x1 < length; x1++, in += inStride, out += outStride) {
+            int4 v = 0;
+            for (size_t c = 0; c < mInputVectorSize; c++) {
+                v[c] = in[c];
+            }
+            int4 sum = mIpRows[0] * v.x + mIpRows[1] * v.y + mIpRows[2] * v.z +
+                       mIpRows[3] * v.w + mIpa;
+            sum = clamp(sum >> 8, 0, 255);
+            for (size_t c = 0; c < mOutputVectorSize; c++) {
+                out[c] = static_cast<uint8_t>(sum[c]);
+            }
+        }
+    }
+
+    static inline float loadChannel(const uint8_t *in, size_t c) {
+        return in[c] * (1.f / 255.f);
+    }
+
+    static inline float loadChannel(const float *in, size_t c) {
+        return in[c];
+    }
+
+    static inline void storeChannel(uint8_t *out, size_t c, float value) {
+        out[c] = static_cast<uint8_t>(clamp(value * 255.f + 0.5f, 0.f, 255.f));
+    }
+
+    static inline void storeChannel(float *out, size_t c, float value) {
+        out[c] = value;
+    }
+
+    template<typename TI, typename TO>
+    void ColorMatrixTask::kernelFloats(const uint8_t *in, uint8_t *out, size_t length) {
+        const TI *typedIn = reinterpret_cast<const TI *>(in);
+        TO *typedOut = reinterpret_cast<TO *>(out);
+        const size_t inStride = paddedSize(mInputVectorSize);
+        const size_t outStride = paddedSize(mOutputVectorSize);
+
+        for (size_t x = 0; x < length; x++, typedIn += inStride, typedOut += outStride) {
+            float4 v = 0.f;
+            for (size_t c = 0; c < mInputVectorSize; c++) {
+                v[c] = loadChannel(typedIn, c);
+            }
+            float4 sum = mFp[0] * v.x + mFp[1] * v.y + mFp[2] * v.z + mFp[3] * v.w + mFpa;
+            for (size_t c = 0; c < mOutputVectorSize; c++) {
+                storeChannel(typedOut, c, sum[c]);
+            }
+        }
+    }
+
+    static inline size_t elementSize(ElementType type) {
+        return type == ElementType::FLOAT ? sizeof(float) : sizeof(uint8_t);
+    }
+
+    void ColorMatrixTask::processData(int /* threadIndex */, size_t startX, size_t startY,
+                                      size_t endX, size_t endY) {
+        const size_t inCellSize = paddedSize(mInputVectorSize) * elementSize(mInputType);
+        const size_t outCellSize = paddedSize(mOutputVectorSize) * elementSize(mOutputType);
+        const bool floatIn = mInputType == ElementType::FLOAT;
+        const bool floatOut = mOutputType == ElementType::FLOAT;
+
+        for (size_t y = startY; y < endY; y++) {
+            size_t offset = y * mSizeX + startX;
+            const uint8_t *in = mIn + offset * inCellSize;
+            uint8_t *out = mOut + offset * outCellSize;
+            size_t length = endX - startX;
+
+            if (mUsesIntegers) {
+                kernelIntegers(in, out, length);
+            } else if (floatIn && floatOut) {
+                kernelFloats<float, float>(in, out, length);
+            } else if (floatIn) {
+                kernelFloats<float, uint8_t>(in, out, length);
+            } else if (floatOut) {
+                kernelFloats<uint8_t, float>(in, out, length);
+            } else {
+                kernelFloats<uint8_t, uint8_t>(in, out, length);
+            }
+        }
+    }
+
+    void RenderScriptToolkit::colorMatrix(const void *in, void *out, size_t inputVectorSize,
+                                          size_t outputVectorSize, size_t sizeX, size_t sizeY,
+                                          const float *matrix, const float *addVector,
+                                          const Restriction *restriction) {
+        colorMatrix(in, ElementType::UCHAR, out, ElementType::UCHAR, inputVectorSize,
+                    outputVectorSize, sizeX, sizeY, matrix, addVector, restriction);
+    }
+
+    void RenderScriptToolkit::colorMatrix(const void *in, ElementType inputType, void *out,
+                                          ElementType outputType, size_t inputVectorSize,
+                                          size_t outputVectorSize, size_t sizeX, size_t sizeY,
+                                          const float *matrix, const float *addVector,
+                                          const Restriction *restriction) {
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (!validRestriction(LOG_TAG, sizeX, sizeY, restriction)) {
+            return;
+        }
+        if (inputVectorSize < 1 || inputVectorSize > 4) {
+            ALOGE("The inputVectorSize should be between 1 and 4. %zu provided.", inputVectorSize);
+            return;
+        }
+        if (outputVectorSize < 1 || outputVectorSize > 4) {
+            ALOGE("The outputVectorSize should be between 1 and 4. %zu provided.",
+                  outputVectorSize);
+            return;
+        }
+#endif
+
+        ColorMatrixTask task(in, inputType, out, outputType, inputVectorSize, outputVectorSize,
+                             sizeX, sizeY, matrix, addVector, restriction);
+        processor->doTask(&task);
+    }
+
+}  // namespace renderscript
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "RenderScriptToolkit.h"
+#include "TaskProcessor.h"
+#include "Utils.h"
+
+namespace renderscript {
+
+#define LOG_TAG "renderscript.toolkit.Convolve"
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+    extern "C" void rsdIntrinsicConvolve3x3_K(void *dst, const void *y0, const void *y1,
+                                              const void *y2, const short *coef, uint32_t count);
+    extern "C" void rsdIntrinsicConvolve5x5_K(void *dst, const void *y0, const void *y1,
+                                              const void *y2, const void *y3, const void *y4,
+                                              const short *coef, uint32_t count);
+#endif
+
+/**
+ * Convolves the image with a square kernel of 3x3 (kRadius 1) or 5x5 (kRadius 2) coefficients.
+ *
+ * The rows of the window are clamped once per output row. Along a row, only the cells less than
+ * kRadius from the left or right edge need their columns clamped; the interior between them reads
+ * its neighbors directly and, for RGBA, goes through the x86 kernels.
+ *
+ * The coefficients are used in 8.8 fixed point, as the x86 kernels expect them, and the scalar
+ * loops do the same arithmetic so that both give the same results. The kernels narrow the sums to
+ * 16 bits before clamping them to a byte, so they are only used when the positive and the negative
+ * coefficients each add up to at most 128, which keeps the sums of any image within range.
+ */
+    template<int kRadius>
+    class ConvolveTask : public Task {
+        static constexpr int kDiameter = 2 * kRadius + 1;
+
+        const uchar *mIn;
+        uchar *mOut;
+        // The coefficients, row major. The x86 kernels read them four at a time, past the last.
+        short mIp[(kDiameter * kDiameter + 3) & ~3] = {};
+        // Whether the x86 kernels can't overflow with these coefficients.
+        bool mKernelsFit = false;
+
+        template<bool kClamp, typename TU, typename TI>
+        TU convolveCell(const TU *const *rows, size_t x) const;
+
+        template<typename TU, typename TI>
+        void convolveRow(TU *out, const TU *const *rows, size_t x1, size_t x2) const;
+
+        // Process a 2D tile of the overall work. threadIndex identifies which thread does the work.
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return kRadius == 1 ? "Convolve3x3" : "Convolve5x5"; }
+
+        ConvolveTask(const void *in, void *out, size_t vectorSize, size_t sizeX, size_t sizeY,
+                     const float *coefficients, const Restriction *restriction)
+                : Task{sizeX, sizeY, vectorSize, false, restriction},
+                  mIn{reinterpret_cast<const uchar *>(in)},
+                  mOut{reinterpret_cast<uchar *>(out)} {
+            int positive = 0;
+            int negative = 0;
+            for (int i = 0; i < kDiameter * kDiameter; i++) {
+                mIp[i] = static_cast<short>(std::lround(coefficients[i] * 256.f));
+                (mIp[i] > 0 ? positive : negative) += mIp[i];
+            }
+            mKernelsFit = positive <= 128 * 256 && negative >= -128 * 256;
+        }
+    };
+
+    template<int kRadius>
+    template<bool kClamp, typename TU, typename TI>
+    TU ConvolveTask<kRadius>::convolveCell(const TU *const *rows, size_t x) const {
+        const int lastX = static_cast<int>(mSizeX) - 1;
+        TI sum = 0;
+        for (int j = 0; j < kDiameter; j++) {
+            for (int i = 0; i < kDiameter; i++) {
+                int column = static_cast<int>(x) + i - kRadius;
+                if (kClamp) {
+                    column = clamp(column, 0, lastX);
+                }
+                sum += convert<TI>(rows[j][column]) * static_cast<int>(mIp[j * kDiameter + i]);
+            }
+        }
+        return convert<TU>(clamp(sum >> 8, 0, 255));
+    }
+
+    template<int kRadius>
+    template<typename TU, typename TI>
+    void ConvolveTask<kRadius>::convolveRow(TU *out, const TU *const *rows, size_t x1,
+                                            size_t x2) const {
+        // The cells in [kRadius, interiorEnd) have their whole window within the row.
+        const size_t interiorEnd = mSizeX - std::min(mSizeX, static_cast<size_t>(kRadius));
+
+        size_t x = x1;
+        for (; x < x2 && x < static_cast<size_t>(kRadius); x++) {
+            out[x] = convolveCell<true, TU, TI>(rows, x);
+        }
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+        if (mUsesSimd && mKernelsFit && sizeof(TU) == 4 && x < interiorEnd) {
+            // The kernels do two (3x3) or four (5x5) cells per count.
+            constexpr size_t kCellsPerCount = kRadius == 1 ? 2 : 4;
+            const uint32_t count =
+                    static_cast<uint32_t>((std::min(x2, interiorEnd) - x) / kCellsPerCount);
+            if (count > 0) {
+                if constexpr (kRadius == 1) {
+                    rsdIntrinsicConvolve3x3_K(out + x, rows[0] + x - 1, rows[1] + x - 1,
+                                              rows[2] + x - 1, mIp, count);
+                } else {
+                    rsdIntrinsicConvolve5x5_K(out + x, rows[0] + x - 2, rows[1] + x - 2,
+                                              rows[2] + x - 2, rows[3] + x - 2, rows[4] + x - 2,
+                                              mIp, count);
+                }
+                x += count * kCellsPerCount;
+            }
+        }
+#endif
+
+        for (; x < x2 && x < interiorEnd; x++) {
+            out[x] = convolveCell<false, TU, TI>(rows, x);
+        }
+        for (; x < x2; x++) {
+            out[x] = convolveCell<true, TU, TI>(rows, x);
+        }
+    }
+
+    template<int kRadius>
+    void ConvolveTask<kRadius>::processData(int /* threadIndex */, size_t startX, size_t startY,
+                                            size_t endX, size_t endY) {
+        const size_t stride = paddedSize(mVectorSize);
+        const int lastY = static_cast<int>(mSizeY) - 1;
+        for (size_t y = startY; y < endY; y++) {
+            const uchar *rows[kDiameter];
+            for (int j = 0; j < kDiameter; j++) {
+                const int row = clamp(static_cast<int>(y) + j - kRadius, 0, lastY);
+                rows[j] = mIn + row * mSizeX * stride;
+            }
+            uchar *out = mOut + y * mSizeX * stride;
+
+            switch (mVectorSize) {
+                case 1:
+                    convolveRow<uchar, int>(out, rows, startX, endX);
+                    break;
+                case 2:
+                    convolveRow<uchar2, int2>(reinterpret_cast<uchar2 *>(out),
+                                              reinterpret_cast<const uchar2 *const *>(rows),
+                                              startX, endX);
+                    break;
+                case 3:
+                case 4:
+                    convolveRow<uchar4, int4>(reinterpret_cast<uchar4 *>(out),
+                                              reinterpret_cast<const uchar4 *const *>(rows),
+                                              startX, endX);
+                    break;
+            }
+        }
+    }
+
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+    template<int kRadius>
+    static bool validConvolve(const char *name, size_t vectorSize, size_t sizeX, size_t sizeY,
+                              const float *coefficients, const Restriction *restriction) {
+        if (!validRestriction(LOG_TAG, sizeX, sizeY, restriction)) {
+            return false;
+        }
+        if (vectorSize < 1 || vectorSize > 4) {
+            ALOGE("%s. The vectorSize should be between 1 and 4. %zu provided.", name,
+                  vectorSize);
+            return false;
+        }
+        constexpr int kCount = (2 * kRadius + 1) * (2 * kRadius + 1);
+        for (int i = 0; i < kCount; i++) {
+            // The coefficients have to fit a short once in 8.8 fixed point.
+            if (!(std::fabs(coefficients[i]) < 127.f)) {
+                ALOGE("%s. Coefficient %d should be between -127 and 127. %f provided.", name, i,
+                      coefficients[i]);
+                return false;
+            }
+        }
+        return true;
+    }
+#endif
+
+    void RenderScriptToolkit::convolve3x3(const void *in, void *out, size_t vectorSize,
+                                          size_t sizeX, size_t sizeY, const float *coefficients,
+                                          const Restriction *restriction) {
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (!validConvolve<1>("convolve3x3", vectorSize, sizeX, sizeY, coefficients,
+                              restriction)) {
+            return;
+        }
+#endif
+
+        ConvolveTask<1> task(in, out, vectorSize, sizeX, sizeY, coefficients, restriction);
+        processor->doTask(&task);
+    }
+
+    void RenderScriptToolkit::convolve5x5(const void *in, void *out, size_t vectorSize,
+                                          size_t sizeX, size_t sizeY, const float *coefficients,
+                                          const Restriction *restriction) {
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (!validConvolve<2>("convolve5x5", vectorSize, sizeX, sizeY, coefficients,
+                              restriction)) {
+            return;
+        }
+#endif
+
+        ConvolveTask<2> task(in, out, vectorSize, sizeX, sizeY, coefficients, restriction);
+        processor->doTask(&task);
+    }
+
+}  // namespace renderscript
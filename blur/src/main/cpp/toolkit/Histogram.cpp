@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "RenderScriptToolkit.h"
+#include "TaskProcessor.h"
+#include "Utils.h"
+
+namespace renderscript {
+
+#define LOG_TAG "renderscript.toolkit.Histogram"
+
+/**
+ * The partial histograms shared by HistogramTask and HistogramDotTask.
+ *
+ * Each thread only increments its own partials, picked by the threadIndex of processData, so the
+ * counting loops need no atomics. The partials are added up once all the tiles are done.
+ *
+ * Every thread has two copies of its bins, one for the even and one for the odd cells of a row.
+ * Blurred images have long runs of equal values, and alternating between two counters lets an
+ * increment start before the previous one of the same value has been stored.
+ */
+    class HistogramTaskBase : public Task {
+    protected:
+        // Number of bins of one copy: 256 per channel, or 256 for the dot product.
+        const size_t mBinCount;
+        // The partials of thread i start at mAlignedSums + i * mThreadStride. Two copies of the bins
+        // each.
+        const size_t mThreadStride;
+        const unsigned int mThreadCount;
+        // A cache line longer than the partials, the vector only aligns them to 16 bytes.
+        std::vector<int32_t> mSums;
+        int32_t *const mAlignedSums;
+
+        int32_t *sumsOf(int threadIndex) { return mAlignedSums + threadIndex * mThreadStride; }
+
+    public:
+        HistogramTaskBase(size_t sizeX, size_t sizeY, size_t vectorSize, size_t binCount,
+                          unsigned int threadCount, const Restriction *restriction)
+                : Task{sizeX, sizeY, vectorSize, true, restriction},
+                  mBinCount{binCount},
+                  // Padded to a multiple of 64 bytes and starting on a 64-byte boundary, so that
+                  // threads don't write to the same cache lines.
+                  mThreadStride{(2 * binCount + 15) & ~size_t{15}},
+                  mThreadCount{threadCount},
+                  mSums(threadCount * mThreadStride + 15, 0),
+                  mAlignedSums{(int32_t *) ((((intptr_t) mSums.data()) + 63) & ~intptr_t{63})} {}
+
+        // Adds up the partials of all the threads into out, which has mBinCount entries.
+        void collateSums(int32_t *out) const;
+    };
+
+    void HistogramTaskBase::collateSums(int32_t *out) const {
+        memset(out, 0, mBinCount * sizeof(int32_t));
+        for (unsigned int thread = 0; thread < mThreadCount; thread++) {
+            const int32_t *even = mAlignedSums + thread * mThreadStride;
+            const int32_t *odd = even + mBinCount;
+            for (size_t i = 0; i < mBinCount; i++) {
+                out[i] += even[i] + odd[i];
+            }
+        }
+    }
+
+/**
+ * Counts the values of each channel of the cells. Channel c of value v is counted in bin
+ * v * paddedSize(vectorSize) + c, the layout of the output.
+ */
+    class HistogramTask : public HistogramTaskBase {
+        const uchar *mIn;
+
+        template<size_t kVectorSize>
+        void kernel(int32_t *even, int32_t *odd, const uchar *in, size_t length);
+
+        // Process a 2D tile of the overall work. threadIndex identifies which thread does the work.
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "Histogram"; }
+
+        HistogramTask(const uint8_t *in, size_t sizeX, size_t sizeY, size_t vectorSize,
+                      unsigned int threadCount, const Restriction *restriction)
+                : HistogramTaskBase{sizeX, sizeY, vectorSize, 256 * paddedSize(vectorSize),
+                                    threadCount, restriction},
+                  mIn{in} {}
+    };
+
+    template<size_t kVectorSize>
+    void HistogramTask::kernel(int32_t *even, int32_t *odd, const uchar *in, size_t length) {
+        constexpr size_t kStride = kVectorSize == 3 ? 4 : kVectorSize;
+        size_t x = 0;
+        for (; x + 1 < length; x += 2, in += 2 * kStride) {
+            for (size_t c = 0; c < kVectorSize; c++) {
+                even[in[c] * kStride + c]++;
+                odd[in[kStride + c] * kStride + c]++;
+            }
+        }
+        if (x < length) {
+            for (size_t c = 0; c < kVectorSize; c++) {
+                even[in[c] * kStride + c]++;
+            }
+        }
+    }
+
+    void HistogramTask::processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                                    size_t endY) {
+        int32_t *even = sumsOf(threadIndex);
+        int32_t *odd = even + mBinCount;
+        const size_t stride = paddedSize(mVectorSize);
+        for (size_t y = startY; y < endY; y++) {
+            const uchar *in = mIn + (mSizeX * y + startX) * stride;
+            const size_t length = endX - startX;
+            switch (mVectorSize) {
+                case 1:
+                    kernel<1>(even, odd, in, length);
+                    break;
+                case 2:
+                    kernel<2>(even, odd, in, length);
+                    break;
+                case 3:
+                    kernel<3>(even, odd, in, length);
+                    break;
+                case 4:
+                    kernel<4>(even, odd, in, length);
+                    break;
+            }
+        }
+    }
+
+/**
+ * Counts the dot product of each cell with a vector of coefficients.
+ */
+    class HistogramDotTask : public HistogramTaskBase {
+        const uchar *mIn;
+        // The coefficients in 8.8 fixed point. Unused channels are 0.
+        int mDotI[4] = {0, 0, 0, 0};
+
+        // The bin of a cell: its rounded dot product, clamped to the last bin.
+        inline uint32_t binOf(const uchar *in) const {
+            uint32_t t = mDotI[0] * in[0];
+            for (size_t c = 1; c < mVectorSize; c++) {
+                t += mDotI[c] * in[c];
+            }
+            t = (t + 0x7f) >> 8;
+            return t > 255 ? 255 : t;
+        }
+
+        // Process a 2D tile of the overall work. threadIndex identifies which thread does the work.
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "HistogramDot"; }
+
+        HistogramDotTask(const uint8_t *in, size_t sizeX, size_t sizeY, size_t vectorSize,
+                         unsigned int threadCount, const float *coefficients,
+                         const Restriction *restriction)
+                : HistogramTaskBase{sizeX, sizeY, vectorSize, 256, threadCount, restriction},
+                  mIn{in} {
+            const float defaultCoefficients[4] = {0.299f, 0.587f, 0.114f, 0.f};
+            const float *coef = coefficients ? coefficients : defaultCoefficients;
+            for (size_t c = 0; c < vectorSize; c++) {
+                mDotI[c] = static_cast<int>(coef[c] * 256.f + 0.5f);
+            }
+        }
+    };
+
+    void HistogramDotTask::processData(int threadIndex, size_t startX, size_t startY,
+                                       size_t endX, size_t endY) {
+        int32_t *even = sumsOf(threadIndex);
+        int32_t *odd = even + mBinCount;
+        const size_t stride = paddedSize(mVectorSize);
+        for (size_t y = startY; y < endY; y++) {
+            const uchar *in = mIn + (mSizeX * y + startX) * stride;
+            const size_t length = endX - startX;
+            size_t x = 0;
+            for (; x + 1 < length; x += 2, in += 2 * stride) {
+                even[binOf(in)]++;
+                odd[binOf(in + stride)]++;
+            }
+            if (x < length) {
+                even[binOf(in)]++;
+            }
+        }
+    }
+
+    void RenderScriptToolkit::histogram(const uint8_t *in, int32_t *out, size_t sizeX,
+                                        size_t sizeY, size_t vectorSize,
+                                        const Restriction *restriction) {
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (!validRestriction(LOG_TAG, sizeX, sizeY, restriction)) {
+            return;
+        }
+        if (vectorSize < 1 || vectorSize > 4) {
+            ALOGE("The vectorSize should be between 1 and 4. %zu provided.", vectorSize);
+            return;
+        }
+#endif
+
+        HistogramTask task(in, sizeX, sizeY, vectorSize, processor->getNumberOfThreads(),
+                           restriction);
+        processor->doTask(&task);
+        task.collateSums(out);
+    }
+
+    void RenderScriptToolkit::histogramDot(const uint8_t *in, int32_t *out, size_t sizeX,
+                                           size_t sizeY, size_t vectorSize,
+                                           const float *coefficients,
+                                           const Restriction *restriction) {
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (!validRestriction(LOG_TAG, sizeX, sizeY, restriction)) {
+            return;
+        }
+        if (vectorSize < 1 || vectorSize > 4) {
+            ALOGE("The vectorSize should be between 1 and 4. %zu provided.", vectorSize);
+            return;
+        }
+        if (coefficients != nullptr) {
+            float sum = 0.0f;
+            for (size_t i = 0; i < vectorSize; i++) {
+                if (coefficients[i] < 0.0f) {
+                    ALOGE("histogramDot coefficients should not be negative. Coefficient %zu was "
+                          "%f.",
+                          i, coefficients[i]);
+                    return;
+                }
+                sum += coefficients[i];
+            }
+            if (sum > 1.0f) {
+                ALOGE("histogramDot coefficients should add to 1 or less. Their sum is %f.", sum);
+                return;
+            }
+        }
+#endif
+
+        HistogramDotTask task(in, sizeX, sizeY, vectorSize, processor->getNumberOfThreads(),
+                              coefficients, restriction);
+        processor->doTask(&task);
+        task.collateSums(out);
+    }
+
+}  // namespace renderscript
@@ -17,6 +17,7 @@
 #include <android/bitmap.h>
 #include <cassert>
 #include <jni.h>
+#include <optional>
 #include <sys/sysconf.h>
 
 #include "RenderScriptToolkit.h"
@@ -180,7 +181,7 @@ public:
         /* TODO Measure how long FindClass and related functions take. Consider passing the
          * four values instead. This would also require setting the default when Range2D is null.
          */
-        jclass restrictionClass = env->FindClass("com/google/android/renderscript/Range2d");
+        jclass restrictionClass = env->FindClass("io/github/pknujsp/blur/toolkit/Range2d");
         if (restrictionClass == nullptr) {
             ALOGE("RenderScriptToolit. Internal error. Could not find the Kotlin Range2d class.");
             isNull = true;
@@ -210,6 +211,367 @@ extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_de
     delete toolkit;
 }
 
+extern "C" JNIEXPORT jboolean JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeLoadTuning(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jstring path) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    const char *chars = env->GetStringUTFChars(path, nullptr);
+    const bool loaded = toolkit->loadTuning(chars);
+    env->ReleaseStringUTFChars(path, chars);
+    return loaded;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeSaveTuning(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jstring path) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    const char *chars = env->GetStringUTFChars(path, nullptr);
+    const bool saved = toolkit->saveTuning(chars);
+    env->ReleaseStringUTFChars(path, chars);
+    return saved;
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeBlend(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jint jmode, jbyteArray source_array,
+        jbyteArray dest_array, jint size_x, jint size_y, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    auto mode = static_cast<RenderScriptToolkit::BlendingMode>(jmode);
+    RestrictionParameter restrict{env, restriction};
+    ByteArrayGuard source{env, source_array};
+    ByteArrayGuard dest{env, dest_array};
+
+    toolkit->blend(mode, source.get(), dest.get(), size_x, size_y, restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeBlendBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jint jmode, jobject source_bitmap,
+        jobject dest_bitmap, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    auto mode = static_cast<RenderScriptToolkit::BlendingMode>(jmode);
+    RestrictionParameter restrict{env, restriction};
+    BitmapGuard source{env, source_bitmap};
+    BitmapGuard dest{env, dest_bitmap};
+
+    toolkit->blend(mode, source.get(), dest.get(), source.width(), source.height(), restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeColorMatrix(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array,
+        jint input_vector_size, jint size_x, jint size_y, jbyteArray output_array,
+        jint output_vector_size, jfloatArray jmatrix, jfloatArray add_vector, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    ByteArrayGuard input{env, input_array};
+    ByteArrayGuard output{env, output_array};
+    FloatArrayGuard matrix{env, jmatrix};
+    FloatArrayGuard add{env, add_vector};
+
+    toolkit->colorMatrix(input.get(), output.get(), input_vector_size, output_vector_size, size_x,
+                         size_y, matrix.get(), add.get(), restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeColorMatrixBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject input_bitmap,
+        jobject output_bitmap, jfloatArray jmatrix, jfloatArray add_vector, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    BitmapGuard input{env, input_bitmap};
+    BitmapGuard output{env, output_bitmap};
+    FloatArrayGuard matrix{env, jmatrix};
+    FloatArrayGuard add{env, add_vector};
+
+    toolkit->colorMatrix(input.get(), output.get(), input.vectorSize(), output.vectorSize(),
+                         input.width(), input.height(), matrix.get(), add.get(), restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeConvolve(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array,
+        jint vector_size, jint size_x, jint size_y, jbyteArray output_array,
+        jfloatArray coefficients, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    ByteArrayGuard input{env, input_array};
+    ByteArrayGuard output{env, output_array};
+    FloatArrayGuard coeffs{env, coefficients};
+
+    switch (env->GetArrayLength(coefficients)) {
+        case 9:
+            toolkit->convolve3x3(input.get(), output.get(), vector_size, size_x, size_y,
+                                 coeffs.get(), restrict.get());
+            break;
+        case 25:
+            toolkit->convolve5x5(input.get(), output.get(), vector_size, size_x, size_y,
+                                 coeffs.get(), restrict.get());
+            break;
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeConvolveBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject input_bitmap,
+        jobject output_bitmap, jfloatArray coefficients, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    BitmapGuard input{env, input_bitmap};
+    BitmapGuard output{env, output_bitmap};
+    FloatArrayGuard coeffs{env, coefficients};
+
+    switch (env->GetArrayLength(coefficients)) {
+        case 9:
+            toolkit->convolve3x3(input.get(), output.get(), input.vectorSize(), input.width(),
+                                 input.height(), coeffs.get(), restrict.get());
+            break;
+        case 25:
+            toolkit->convolve5x5(input.get(), output.get(), input.vectorSize(), input.width(),
+                                 input.height(), coeffs.get(), restrict.get());
+            break;
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeHistogram(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array,
+        jint vector_size, jint size_x, jint size_y, jintArray output_array, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    ByteArrayGuard input{env, input_array};
+    IntArrayGuard output{env, output_array};
+
+    toolkit->histogram(input.get(), output.get(), size_x, size_y, vector_size, restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeHistogramBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject input_bitmap,
+        jintArray output_array, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    BitmapGuard input{env, input_bitmap};
+    IntArrayGuard output{env, output_array};
+
+    toolkit->histogram(input.get(), output.get(), input.width(), input.height(),
+                       input.vectorSize(), restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeHistogramDot(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array,
+        jint vector_size, jint size_x, jint size_y, jintArray output_array,
+        jfloatArray coefficients, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    ByteArrayGuard input{env, input_array};
+    IntArrayGuard output{env, output_array};
+    FloatArrayGuard coeffs{env, coefficients};
+
+    toolkit->histogramDot(input.get(), output.get(), size_x, size_y, vector_size, coeffs.get(),
+                          restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeHistogramDotBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject input_bitmap,
+        jintArray output_array, jfloatArray coefficients, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    BitmapGuard input{env, input_bitmap};
+    IntArrayGuard output{env, output_array};
+    FloatArrayGuard coeffs{env, coefficients};
+
+    toolkit->histogramDot(input.get(), output.get(), input.width(), input.height(),
+                          input.vectorSize(), coeffs.get(), restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeLut(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array,
+        jbyteArray output_array, jint size_x, jint size_y, jbyteArray red_table,
+        jbyteArray green_table, jbyteArray blue_table, jbyteArray alpha_table,
+        jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    ByteArrayGuard input{env, input_array};
+    ByteArrayGuard output{env, output_array};
+    ByteArrayGuard red{env, red_table};
+    ByteArrayGuard green{env, green_table};
+    ByteArrayGuard blue{env, blue_table};
+    ByteArrayGuard alpha{env, alpha_table};
+
+    toolkit->lut(input.get(), output.get(), size_x, size_y, red.get(), green.get(), blue.get(),
+                 alpha.get(), restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeLutBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject input_bitmap,
+        jobject output_bitmap, jbyteArray red_table, jbyteArray green_table,
+        jbyteArray blue_table, jbyteArray alpha_table, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    BitmapGuard input{env, input_bitmap};
+    BitmapGuard output{env, output_bitmap};
+    ByteArrayGuard red{env, red_table};
+    ByteArrayGuard green{env, green_table};
+    ByteArrayGuard blue{env, blue_table};
+    ByteArrayGuard alpha{env, alpha_table};
+
+    toolkit->lut(input.get(), output.get(), input.width(), input.height(), red.get(), green.get(),
+                 blue.get(), alpha.get(), restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeLut3d(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array,
+        jbyteArray output_array, jint size_x, jint size_y, jbyteArray cube_values,
+        jint cube_size_x, jint cube_size_y, jint cube_size_z, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    ByteArrayGuard input{env, input_array};
+    ByteArrayGuard output{env, output_array};
+    ByteArrayGuard cube{env, cube_values};
+
+    toolkit->lut3d(input.get(), output.get(), size_x, size_y, cube.get(), cube_size_x,
+                   cube_size_y, cube_size_z, restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeLut3dBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject input_bitmap,
+        jobject output_bitmap, jbyteArray cube_values, jint cube_size_x, jint cube_size_y,
+        jint cube_size_z, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    BitmapGuard input{env, input_bitmap};
+    BitmapGuard output{env, output_bitmap};
+    ByteArrayGuard cube{env, cube_values};
+
+    toolkit->lut3d(input.get(), output.get(), input.width(), input.height(), cube.get(),
+                   cube_size_x, cube_size_y, cube_size_z, restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativePipelineBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject input_bitmap,
+        jobject output_bitmap, jint resize_filter, jfloat blur_radius, jfloatArray color_matrix,
+        jfloatArray color_add_vector, jint blend_mode, jint blend_color) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    BitmapGuard input{env, input_bitmap};
+    BitmapGuard output{env, output_bitmap};
+    std::optional<FloatArrayGuard> matrix;
+    std::optional<FloatArrayGuard> add;
+    if (color_matrix != nullptr) {
+        matrix.emplace(env, color_matrix);
+    }
+    if (color_add_vector != nullptr) {
+        add.emplace(env, color_add_vector);
+    }
+
+    RenderScriptToolkit::PipelineOptions options;
+    options.outputSizeX = output.width();
+    options.outputSizeY = output.height();
+    options.resizeFilter = static_cast<RenderScriptToolkit::ResizeFilter>(resize_filter);
+    options.blurRadius = blur_radius;
+    options.colorMatrix = matrix ? matrix->get() : nullptr;
+    options.colorAddVector = add ? add->get() : nullptr;
+    options.blendMode = static_cast<RenderScriptToolkit::BlendingMode>(blend_mode);
+    // Bitmaps hold premultiplied RGBA, the color is an unpremultiplied ARGB Int.
+    const uint32_t color = static_cast<uint32_t>(blend_color);
+    const uint32_t alpha = color >> 24;
+    for (int c = 0; c < 3; c++) {
+        const uint32_t channel = (color >> (16 - 8 * c)) & 0xff;
+        options.blendColor[c] = static_cast<uint8_t>((channel * alpha + 127) / 255);
+    }
+    options.blendColor[3] = static_cast<uint8_t>(alpha);
+
+    toolkit->pipeline(input.get(), output.get(), input.width(), input.height(), options);
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeResize(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array,
+        jint vector_size, jint input_size_x, jint input_size_y, jbyteArray output_array,
+        jint output_size_x, jint output_size_y, jint filter, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    ByteArrayGuard input{env, input_array};
+    ByteArrayGuard output{env, output_array};
+
+    toolkit->resize(input.get(), output.get(), input_size_x, input_size_y, vector_size,
+                    output_size_x, output_size_y,
+                    static_cast<RenderScriptToolkit::ResizeFilter>(filter), restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeResizeBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject input_bitmap,
+        jobject output_bitmap, jint filter, jobject restriction) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RestrictionParameter restrict{env, restriction};
+    BitmapGuard input{env, input_bitmap};
+    BitmapGuard output{env, output_bitmap};
+
+    toolkit->resize(input.get(), output.get(), input.width(), input.height(), input.vectorSize(),
+                    output.width(), output.height(),
+                    static_cast<RenderScriptToolkit::ResizeFilter>(filter), restrict.get());
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeYuvToRgb(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array,
+        jbyteArray output_array, jint size_x, jint size_y, jint format) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    ByteArrayGuard input{env, input_array};
+    ByteArrayGuard output{env, output_array};
+
+    toolkit->yuvToRgb(input.get(), output.get(), size_x, size_y,
+                      static_cast<RenderScriptToolkit::YuvFormat>(format));
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeYuvToRgbBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array, jint size_x,
+        jint size_y, jobject output_bitmap, jint format) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    BitmapGuard output{env, output_bitmap};
+    ByteArrayGuard input{env, input_array};
+
+    toolkit->yuvToRgb(input.get(), output.get(), size_x, size_y,
+                      static_cast<RenderScriptToolkit::YuvFormat>(format));
+}
+
+/**
+ * The planes of an android.media.Image are direct ByteBuffers, so they are read in place.
+ */
+static bool yuvPlanesOf(JNIEnv *env, jobject y_buffer, jobject u_buffer, jobject v_buffer,
+                        jint y_row_stride, jint uv_row_stride, jint uv_pixel_stride,
+                        RenderScriptToolkit::YuvPlanes *planes) {
+    planes->y = reinterpret_cast<const uint8_t *>(env->GetDirectBufferAddress(y_buffer));
+    planes->u = reinterpret_cast<const uint8_t *>(env->GetDirectBufferAddress(u_buffer));
+    planes->v = reinterpret_cast<const uint8_t *>(env->GetDirectBufferAddress(v_buffer));
+    planes->yRowStride = y_row_stride;
+    planes->uvRowStride = uv_row_stride;
+    planes->uvPixelStride = uv_pixel_stride;
+    if (planes->y == nullptr || planes->u == nullptr || planes->v == nullptr) {
+        ALOGE("The YUV planes should be direct ByteBuffers.");
+        return false;
+    }
+    return true;
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeYuvPlanesToRgbBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject y_buffer, jobject u_buffer,
+        jobject v_buffer, jint y_row_stride, jint uv_row_stride, jint uv_pixel_stride,
+        jint size_x, jint size_y, jobject output_bitmap) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RenderScriptToolkit::YuvPlanes planes;
+    if (!yuvPlanesOf(env, y_buffer, u_buffer, v_buffer, y_row_stride, uv_row_stride,
+                     uv_pixel_stride, &planes)) {
+        return;
+    }
+    BitmapGuard output{env, output_bitmap};
+
+    toolkit->yuvToRgb(planes, output.get(), size_x, size_y);
+}
+
+extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeBlurYuvPlanesBitmap(
+        JNIEnv *env, jobject /*thiz*/, jlong native_handle, jobject y_buffer, jobject u_buffer,
+        jobject v_buffer, jint y_row_stride, jint uv_row_stride, jint uv_pixel_stride,
+        jint size_x, jint size_y, jobject output_bitmap, jint radius) {
+    auto toolkit = reinterpret_cast<RenderScriptToolkit *>(native_handle);
+    RenderScriptToolkit::YuvPlanes planes;
+    if (!yuvPlanesOf(env, y_buffer, u_buffer, v_buffer, y_row_stride, uv_row_stride,
+                     uv_pixel_stride, &planes)) {
+        return;
+    }
+    BitmapGuard output{env, output_bitmap};
+
+    toolkit->yuvToRgbAndBlur(planes, output.get(), size_x, size_y, radius);
+}
 
 extern "C" JNIEXPORT void JNICALL Java_io_github_pknujsp_blur_toolkit_Toolkit_nativeBlur(
         JNIEnv *env, jobject /*thiz*/, jlong native_handle, jbyteArray input_array, jint vectorSize,
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdint>
+
+#include "RenderScriptToolkit.h"
+#include "TaskProcessor.h"
+#include "Utils.h"
+
+namespace renderscript {
+
+#define LOG_TAG "renderscript.toolkit.Lut3d"
+
+/**
+ * Converts the RGB of each cell by trilinear interpolation of a cube of RGBA entries.
+ *
+ * Where a channel value falls in the cube only depends on the value, so the byte offset of the
+ * cell and the interpolation weights are computed once per task for the 256 values of each axis.
+ * The work per cell is then three table reads, the eight corners and the blends. The tables take
+ * 6KB and stay in L1 while a tile is processed; the cube is only read, and is shared by the cache
+ * of all the threads.
+ *
+ * The weights are in 7 bit fixed point so that the x86 kernel can blend with madd_epi16. The
+ * scalar loop does the same arithmetic and gives the same results.
+ */
+    class Lut3dTask : public Task {
+        const uchar4 *mIn;
+        uchar4 *mOut;
+        const uchar *mCube;
+        // Distance in bytes between two consecutive entries along Y and along Z.
+        const size_t mStrideY;
+        const size_t mStrideZ;
+        // For the red, green and blue tables in turn: the byte offset of the first corner of the
+        // cell of each value along the axis of the channel.
+        uint32_t mOffsets[3 * 256];
+        // Likewise, the weights of the first and second corner, as (128 - f) | f << 16.
+        uint32_t mWeights[3 * 256];
+
+        void fillAxis(int axis, size_t cubeSize, size_t stride);
+
+        void kernel(uchar4 *out, const uchar4 *in, size_t length) const;
+
+        // Process a 2D tile of the overall work. threadIndex identifies which thread does the work.
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "Lut3d"; }
+
+        Lut3dTask(const uint8_t *input, uint8_t *output, size_t sizeX, size_t sizeY,
+                  const uint8_t *cube, size_t cubeSizeX, size_t cubeSizeY, size_t cubeSizeZ,
+                  const Restriction *restriction)
+                : Task{sizeX, sizeY, 4, true, restriction},
+                  mIn{reinterpret_cast<const uchar4 *>(input)},
+                  mOut{reinterpret_cast<uchar4 *>(output)},
+                  mCube{cube},
+                  mStrideY{cubeSizeX * 4},
+                  mStrideZ{cubeSizeX * cubeSizeY * 4} {
+            fillAxis(0, cubeSizeX, 4);
+            fillAxis(1, cubeSizeY, mStrideY);
+            fillAxis(2, cubeSizeZ, mStrideZ);
+        }
+    };
+
+    void Lut3dTask::fillAxis(int axis, size_t cubeSize, size_t stride) {
+        const uint32_t last = static_cast<uint32_t>(cubeSize - 1);
+        for (uint32_t v = 0; v < 256; v++) {
+            // The position of v along the axis, rounded to 1/128th of a cell. The last value falls
+            // on the far corner of the last cell rather than in a cell past the end.
+            const uint32_t position = (v * last * 256 + 255) / 510;
+            const uint32_t base = std::min(position >> 7, last - 1);
+            const uint32_t f = position - (base << 7);
+            mOffsets[axis * 256 + v] = static_cast<uint32_t>(base * stride);
+            mWeights[axis * 256 + v] = (128 - f) | (f << 16);
+        }
+    }
+
+    void Lut3dTask::kernel(uchar4 *out, const uchar4 *in, size_t length) const {
+        for (size_t i = 0; i < length; i++) {
+            const uchar4 p = in[i];
+            const uchar *c = mCube + mOffsets[p.x] + mOffsets[256 + p.y] + mOffsets[512 + p.z];
+            const uint32_t wx = mWeights[p.x];
+            const uint32_t wy = mWeights[256 + p.y];
+            const uint32_t wz = mWeights[512 + p.z];
+
+            auto corners = [&](size_t offset) {
+                const uchar4 *pair = reinterpret_cast<const uchar4 *>(c + offset);
+                return convert<int4>(pair[0]) * static_cast<int>(wx & 0xffff) +
+                       convert<int4>(pair[1]) * static_cast<int>(wx >> 16);
+            };
+            const int4 x00 = corners(0);
+            const int4 x10 = corners(mStrideY);
+            const int4 x01 = corners(mStrideZ);
+            const int4 x11 = corners(mStrideY + mStrideZ);
+
+            const int wy1 = static_cast<int>(wy & 0xffff);
+            const int wy2 = static_cast<int>(wy >> 16);
+            const int4 z0 = (x00 * wy1 + x10 * wy2) >> 7;
+            const int4 z1 = (x01 * wy1 + x11 * wy2) >> 7;
+
+            const int4 v = (z0 * static_cast<int>(wz & 0xffff) +
+                            z1 * static_cast<int>(wz >> 16) + (1 << 13)) >> 14;
+            uchar4 result = convert<uchar4>(v);
+            result.w = p.w;
+            out[i] = result;
+        }
+    }
+
+    void Lut3dTask::processData(int /* threadIndex */, size_t startX, size_t startY, size_t endX,
+                                size_t endY) {
+        for (size_t y = startY; y < endY; y++) {
+            const size_t offset = mSizeX * y + startX;
+            const uchar4 *in = mIn + offset;
+            uchar4 *out = mOut + offset;
+            const size_t length = endX - startX;
+#if defined(ARCH_X86_HAVE_SSSE3)
+            if (mUsesSimd) {
+                mX86Kernels->lut3d(out, in, mCube, mOffsets, mWeights, mStrideY, mStrideZ,
+                                   static_cast<uint32_t>(length));
+                continue;
+            }
+#endif
+            kernel(out, in, length);
+        }
+    }
+
+    void RenderScriptToolkit::lut3d(const uint8_t *input, uint8_t *output, size_t sizeX,
+                                    size_t sizeY, const uint8_t *cube, size_t cubeSizeX,
+                                    size_t cubeSizeY, size_t cubeSizeZ,
+                                    const Restriction *restriction) {
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (!validRestriction(LOG_TAG, sizeX, sizeY, restriction)) {
+            return;
+        }
+        if (cubeSizeX < 2 || cubeSizeY < 2 || cubeSizeZ < 2 || cubeSizeX > 256 ||
+            cubeSizeY > 256 || cubeSizeZ > 256) {
+            ALOGE("The dimensions of the cube should be between 2 and 256. (%zu, %zu, %zu) "
+                  "provided.",
+                  cubeSizeX, cubeSizeY, cubeSizeZ);
+            return;
+        }
+#endif
+
+        Lut3dTask task(input, output, sizeX, sizeY, cube, cubeSizeX, cubeSizeY, cubeSizeZ,
+                       restriction);
+        processor->doTask(&task);
+    }
+
+}  // namespace renderscript
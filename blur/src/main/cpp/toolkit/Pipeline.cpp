@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "RenderScriptToolkit.h"
+#include "Stages.h"
+#include "TaskProcessor.h"
+#include "Utils.h"
+
+namespace renderscript {
+
+#define LOG_TAG "renderscript.toolkit.Pipeline"
+
+    using BlendingMode = RenderScriptToolkit::BlendingMode;
+    using PipelineOptions = RenderScriptToolkit::PipelineOptions;
+
+/**
+ * Resizes, blurs, transforms and blends an RGBA image, one output tile at a time.
+ *
+ * A tile produces the resized rows it needs from its first row minus the radius to its last row
+ * plus the radius, over its columns plus the radius on either side. Each resized row is blurred
+ * horizontally into a ring of 2 * radius + 1 rows as soon as it is produced; once the ring holds
+ * the rows around an output row, that row is blurred vertically, transformed and rounded into
+ * the output, and the blend color is blended into it while it is still in L1.
+ *
+ * All the intermediate rows live in per-thread scratch owned by the task, so nothing the size of
+ * the image is written between the operations. Tiles have at least a few times the radius in
+ * rows so that the rows recomputed around them stay a small part of the work.
+ */
+    class PipelineTask : public Task {
+        const uchar4 *mIn;
+        uchar4 *mOut;
+        const size_t mInputSizeX;
+        const size_t mInputSizeY;
+
+        const bool mResizes;
+        const ResizeTaps mTapsX;
+        const ResizeTaps mTapsY;
+
+        int mIradius = 0;
+        float mFp[2 * kMaxBlurTaskRadius + 1];
+
+        bool mTransforms = false;
+        // The rows of the matrix, and the add vector on the 0-255 scale of the channels.
+        float4 mMatrix[4];
+        float4 mAdd;
+
+        const BlendingMode mBlendMode;
+        const uchar4 mBlendColor;
+
+        struct Scratch {
+            // The input rows filtered horizontally by the resize, one per tap of mTapsY.
+            std::vector<float4> resizeRing;
+            std::vector<uint32_t> rowInSlot;
+            // One resized row, over the columns of the tile plus the radius on both sides.
+            std::vector<float4> resized;
+            // The last 2 * mIradius + 1 resized rows, blurred horizontally.
+            std::vector<float4> blurRing;
+            // The blend color, repeated over the width of the tile.
+            std::vector<uchar4> blendRow;
+        };
+        std::vector<Scratch> mScratch;
+
+        // Computes resized row y over the columns [startX, endX) into out.
+        void resizeRow(Scratch &scratch, size_t y, size_t startX, size_t endX, float4 *out) const;
+
+        // Process a 2D tile of the overall work. threadIndex identifies which thread does the work.
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "Pipeline"; }
+
+        PipelineTask(const uint8_t *in, uint8_t *out, size_t inputSizeX, size_t inputSizeY,
+                     size_t outputSizeX, size_t outputSizeY, const PipelineOptions &options,
+                     unsigned int threadCount)
+                : Task{outputSizeX, outputSizeY, 4, false, nullptr},
+                  mIn{reinterpret_cast<const uchar4 *>(in)},
+                  mOut{reinterpret_cast<uchar4 *>(out)},
+                  mInputSizeX{inputSizeX},
+                  mInputSizeY{inputSizeY},
+                  mResizes{inputSizeX != outputSizeX || inputSizeY != outputSizeY},
+                  mTapsX{options.resizeFilter, inputSizeX, outputSizeX},
+                  mTapsY{options.resizeFilter, inputSizeY, outputSizeY},
+                  mBlendMode{options.blendMode},
+                  mBlendColor{options.blendColor[0], options.blendColor[1],
+                              options.blendColor[2], options.blendColor[3]},
+                  mScratch(threadCount) {
+            if (options.blurRadius > 0.f) {
+                uint16_t ip[2 * kMaxBlurTaskRadius + 1];
+                mIradius = computeGaussianWeights(
+                        std::min((float) kMaxBlurTaskRadius, options.blurRadius), mFp, ip);
+            } else {
+                mFp[0] = 1.f;
+            }
+            if (options.colorMatrix != nullptr) {
+                mTransforms = true;
+                const float *m = options.colorMatrix;
+                for (int i = 0; i < 4; i++) {
+                    mMatrix[i] = float4{m[i * 4], m[i * 4 + 1], m[i * 4 + 2], m[i * 4 + 3]};
+                    mAdd[i] = options.colorAddVector == nullptr
+                              ? 0.f : options.colorAddVector[i] * 255.f;
+                }
+            }
+            mMinRowsPerTile = std::max<size_t>(
+                    1, std::min(std::max<size_t>(16, 4 * mIradius),
+                                divideRoundingUp(outputSizeY, 2 * threadCount)));
+        }
+    };
+
+    void PipelineTask::resizeRow(Scratch &scratch, size_t y, size_t startX, size_t endX,
+                                 float4 *out) const {
+        if (!mResizes) {
+            const uchar4 *in = mIn + y * mInputSizeX;
+            for (size_t x = startX; x < endX; x++) {
+                *out++ = convert<float4>(in[x]);
+            }
+            return;
+        }
+
+        const size_t width = endX - startX;
+        const size_t ringSize = mTapsY.count;
+        const uint32_t *rowIndices = &mTapsY.indices[y * ringSize];
+        const float *rowWeights = &mTapsY.weights[y * ringSize];
+
+        for (size_t t = 0; t < ringSize; t++) {
+            const uint32_t row = rowIndices[t];
+            const size_t slot = row % ringSize;
+            if (scratch.rowInSlot[slot] == row) {
+                continue;
+            }
+            scratch.rowInSlot[slot] = row;
+
+            const uchar4 *inRow = mIn + row * mInputSizeX;
+            float4 *filtered = scratch.resizeRing.data() + slot * width;
+            for (size_t x = startX; x < endX; x++) {
+                const uint32_t *indices = &mTapsX.indices[x * mTapsX.count];
+                const float *weights = &mTapsX.weights[x * mTapsX.count];
+                float4 sum = 0.f;
+                for (size_t tx = 0; tx < mTapsX.count; tx++) {
+                    sum += convert<float4>(inRow[indices[tx]]) * weights[tx];
+                }
+                filtered[x - startX] = sum;
+            }
+        }
+
+        for (size_t x = 0; x < width; x++) {
+            float4 sum = 0.f;
+            for (size_t t = 0; t < ringSize; t++) {
+                sum += scratch.resizeRing[(rowIndices[t] % ringSize) * width + x] * rowWeights[t];
+            }
+            out[x] = sum;
+        }
+    }
+
+    void PipelineTask::processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                                   size_t endY) {
+        Scratch &scratch = mScratch[threadIndex];
+        const size_t radius = static_cast<size_t>(mIradius);
+        const size_t diameter = 2 * radius + 1;
+        const size_t width = endX - startX;
+        // The resized columns the tile reads, before and after clamping to the image.
+        const size_t paddedWidth = width + 2 * radius;
+        const size_t firstX = startX > radius ? startX - radius : 0;
+        const size_t lastX = std::min(endX + radius, mSizeX);
+
+        if (scratch.resized.size() < paddedWidth) {
+            scratch.resized.resize(paddedWidth);
+        }
+        if (scratch.blurRing.size() < diameter * width) {
+            scratch.blurRing.resize(diameter * width);
+        }
+        if (mResizes) {
+            if (scratch.resizeRing.size() < mTapsY.count * (lastX - firstX)) {
+                scratch.resizeRing.resize(mTapsY.count * (lastX - firstX));
+            }
+            // The ring is indexed by the columns of the tile, so it can't carry over.
+            scratch.rowInSlot.assign(mTapsY.count, UINT32_MAX);
+        }
+        if (mBlendMode != BlendingMode::DST && scratch.blendRow.size() < width) {
+            scratch.blendRow.assign(width, mBlendColor);
+        }
+#if defined(ARCH_X86_HAVE_SSSE3)
+        const X86Kernels *x86Kernels = mUsesSimd ? mX86Kernels : nullptr;
+#else
+        const X86Kernels *x86Kernels = nullptr;
+#endif
+
+        const int lastRow = static_cast<int>(mSizeY) - 1;
+        int nextRow = std::max(0, static_cast<int>(startY) - mIradius);
+
+        for (size_t y = startY; y < endY; y++) {
+            // Blur horizontally the rows up to the bottom of the window of y.
+            const int neededRow = std::min(lastRow, static_cast<int>(y) + mIradius);
+            for (; nextRow <= neededRow; nextRow++) {
+                float4 *resized = scratch.resized.data();
+                float4 *inImage = resized + (firstX + radius - startX);
+                resizeRow(scratch, nextRow, firstX, lastX, inImage);
+                // Repeat the edges of the image where the tile reads past them.
+                std::fill(resized, inImage, inImage[0]);
+                std::fill(inImage + (lastX - firstX), resized + paddedWidth,
+                          inImage[lastX - firstX - 1]);
+
+                float4 *blurred = scratch.blurRing.data() + (nextRow % diameter) * width;
+                for (size_t x = 0; x < width; x++) {
+                    float4 sum = 0.f;
+                    for (size_t k = 0; k < diameter; k++) {
+                        sum += resized[x + k] * mFp[k];
+                    }
+                    blurred[x] = sum;
+                }
+            }
+
+            const float4 *window[2 * kMaxBlurTaskRadius + 1];
+            for (size_t k = 0; k < diameter; k++) {
+                const int row = clamp(static_cast<int>(y + k) - mIradius, 0, lastRow);
+                window[k] = scratch.blurRing.data() + (row % diameter) * width;
+            }
+
+            uchar4 *out = mOut + y * mSizeX + startX;
+            for (size_t x = 0; x < width; x++) {
+                float4 v = 0.f;
+                for (size_t k = 0; k < diameter; k++) {
+                    v += window[k][x] * mFp[k];
+                }
+                if (mTransforms) {
+                    v = mMatrix[0] * v.x + mMatrix[1] * v.y + mMatrix[2] * v.z +
+                        mMatrix[3] * v.w + mAdd;
+                }
+                out[x] = convert<uchar4>(clamp(v + 0.5f, 0.f, 255.f));
+            }
+            if (mBlendMode != BlendingMode::DST) {
+                blendRow(mBlendMode, scratch.blendRow.data(), out, static_cast<uint32_t>(width),
+                         x86Kernels);
+            }
+        }
+    }
+
+    void RenderScriptToolkit::pipeline(const uint8_t *in, uint8_t *out, size_t sizeX,
+                                       size_t sizeY, const PipelineOptions &options) {
+        const size_t outputSizeX = options.outputSizeX == 0 ? sizeX : options.outputSizeX;
+        const size_t outputSizeY = options.outputSizeY == 0 ? sizeY : options.outputSizeY;
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (sizeX == 0 || sizeY == 0) {
+            ALOGE("The input should not be empty. %zu by %zu provided.", sizeX, sizeY);
+            return;
+        }
+        if (options.blurRadius < 0.f || options.blurRadius > kMaxBlurTaskRadius) {
+            ALOGE("The blurRadius should be between 0 and %d. %f provided.", kMaxBlurTaskRadius,
+                  options.blurRadius);
+            return;
+        }
+#endif
+
+        PipelineTask task(in, out, sizeX, sizeY, outputSizeX, outputSizeY, options,
+                          processor->getNumberOfThreads());
+        processor->doTask(&task);
+    }
+
+}  // namespace renderscript
@@ -33,4 +33,8 @@ namespace renderscript {
         // in RenderScriptToolkit.h.
     }
 
+    bool RenderScriptToolkit::loadTuning(const char *path) { return processor->loadTuning(path); }
+
+    bool RenderScriptToolkit::saveTuning(const char *path) { return processor->saveTuning(path); }
+
 }  // namespace renderscript
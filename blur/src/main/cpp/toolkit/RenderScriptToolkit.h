@@ -19,6 +19,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace renderscript {
 
@@ -74,6 +76,36 @@ namespace renderscript {
          */
         std::unique_ptr<TaskProcessor> processor;
 
+        /** Intermediate image of the separable blur, grown as needed and reused by later calls.
+         * A blur runs two tasks over it, so it has its own lock.
+         */
+        std::vector<uint16_t> blurIntermediate;
+        std::mutex blurIntermediateMutex;
+
+        /** RGBA image between the conversion and the blur of yuvToRgbAndBlur(), reused like
+         * blurIntermediate.
+         */
+        std::vector<uint8_t> yuvIntermediate;
+        std::mutex yuvIntermediateMutex;
+
+        /** Downscaled copy of the image and its blur, for the radii blur() can't do directly.
+         * Reused like blurIntermediate. Locked before blurIntermediateMutex, which separableBlur()
+         * takes while it's held.
+         */
+        std::vector<uint8_t> blurSmall;
+        std::vector<uint8_t> blurSmallBlurred;
+        std::mutex blurSmallMutex;
+
+        /** Whether blur() should use separableBlur() rather than the single pass BlurTask.
+         */
+        static bool useSeparableBlur(size_t sizeX);
+
+        /** Blurs with a full vertical pass into blurIntermediate followed by a horizontal pass.
+         * Each pass is a weighted sum of contiguous rows, and no per-row buffer limits the width.
+         */
+        void separableBlur(const uint8_t *in, uint8_t *out, size_t sizeX, size_t sizeY,
+                           size_t vectorSize, float radius, const Restriction *restriction);
+
     public:
         /**
          * Creates the pool threads that are used for processing the method calls.
@@ -88,6 +120,24 @@ namespace renderscript {
          */
         ~RenderScriptToolkit();
 
+        /**
+         * Loads the tilings learned by a previous run of the application from a file written by
+         * saveTuning().
+         *
+         * The Toolkit picks the tile size and the number of threads of each operation from the
+         * size of the data and the caches of the device, and adjusts them from the time the
+         * operations take. Loading the previous choices skips most of that learning.
+         *
+         * Returns false if the file can't be read or was saved on another device.
+         */
+        bool loadTuning(const char *_Nonnull path);
+
+        /**
+         * Saves the tilings learned so far, to be loaded by loadTuning(). Returns false if the file
+         * can't be written.
+         */
+        bool saveTuning(const char *_Nonnull path);
+
         /**
          * Determines how a source buffer is blended into a destination buffer.
          *
@@ -197,10 +247,12 @@ namespace renderscript {
          *
          * Performs a Gaussian blur of the input image and stores the result in the out buffer.
          *
-         * The radius determines which pixels are used to compute each blurred pixels. This Toolkit
-         * accepts values between 1 and 25. Larger values create a more blurred effect but also
-         * take longer to compute. When the radius extends past the edge, the edge pixel will
-         * be used as replacement for the pixel that's out off boundary.
+         * The radius determines which pixels are used to compute each blurred pixels. Larger values
+         * create a more blurred effect. Radii up to 25 take longer to compute as they grow. Larger
+         * radii are computed on a copy of the image downscaled to bring the radius back to 25 or
+         * less, then scaled back up, so their cost does not grow with the radius. When the radius
+         * extends past the edge, the edge pixel will be used as replacement for the pixel that's
+         * out off boundary.
          *
          * Each input pixel can either be represented by four bytes (RGBA format) or one byte
          * for the less common blurring of alpha channel only image.
@@ -317,6 +369,41 @@ namespace renderscript {
                          const float *_Nonnull matrix, const float *_Nullable addVector = nullptr,
                          const Restriction *_Nullable restriction = nullptr);
 
+        /**
+         * The type of the channels of the vectors passed to the colorMatrix overload below.
+         */
+        enum class ElementType {
+            // Unsigned bytes, mapped from 0-255 to 0.0-1.0 and back.
+            UCHAR,
+            // Floats, used as is.
+            FLOAT,
+        };
+
+        /**
+         * Transform an image using a color matrix, reading or writing float vectors.
+         *
+         * Same as the colorMatrix method above, except that each side can hold floats instead of
+         * unsigned bytes. Float channels are neither normalized on input nor clamped on output.
+         * As with bytes, vectors of 3 floats are padded to 4.
+         *
+         * @param in The buffer of the image to be converted.
+         * @param inputType The type of the channels of the input vectors.
+         * @param out The buffer that receives the converted image.
+         * @param outputType The type of the channels of the output vectors.
+         * @param inputVectorSize The number of channels in each input cell, a value from 1 to 4.
+         * @param outputVectorSize The number of channels in each output cell, a value from 1 to 4.
+         * @param sizeX The width of both buffers, as a number of cells.
+         * @param sizeY The height of both buffers, as a number of cells.
+         * @param matrix The 4x4 matrix to multiply, in row major format.
+         * @param addVector A vector of four floats that's added to the result of the multiplication.
+         * @param restriction When not null, restricts the operation to a 2D range of pixels.
+         */
+        void colorMatrix(const void *_Nonnull in, ElementType inputType, void *_Nonnull out,
+                         ElementType outputType, size_t inputVectorSize, size_t outputVectorSize,
+                         size_t sizeX, size_t sizeY, const float *_Nonnull matrix,
+                         const float *_Nullable addVector = nullptr,
+                         const Restriction *_Nullable restriction = nullptr);
+
         /**
          * Convolve a ByteArray.
          *
@@ -453,7 +540,7 @@ namespace renderscript {
          * is stored in the output.
          *
          * The input array should be in RGBA format, where four consecutive bytes form an cell.
-         * The fourth byte of each input cell is ignored.
+         * The fourth byte of each input cell is copied unchanged to the output.
          *
          * An optional range parameter can be set to restrict the operation to a rectangular subset
          * of each buffer. If provided, the range must be wholly contained with the dimensions
@@ -505,6 +592,36 @@ namespace renderscript {
                     size_t inputSizeY, size_t vectorSize, size_t outputSizeX, size_t outputSizeY,
                     const Restriction *_Nullable restriction = nullptr);
 
+        /**
+         * The filters of the resize overload below.
+         */
+        enum class ResizeFilter {
+            // Catmull-Rom bicubic interpolation, the filter of the RenderScript intrinsic.
+            BICUBIC = 0,
+            // Each output cell averages the input cells it covers. Use it to scale down by
+            // large factors, where bicubic interpolation skips input cells.
+            AREA = 1,
+        };
+
+        /**
+         * Resize an image with the given filter.
+         *
+         * Same as the resize method above, which uses ResizeFilter::BICUBIC.
+         *
+         * @param in The buffer of the image to be resized.
+         * @param out The buffer that receives the resized image.
+         * @param inputSizeX The width of the input buffer, as a number of 1-4 byte cells.
+         * @param inputSizeY The height of the input buffer, as a number of 1-4 byte cells.
+         * @param vectorSize The number of bytes in each cell of both buffers. A value from 1 to 4.
+         * @param outputSizeX The width of the output buffer, as a number of 1-4 byte cells.
+         * @param outputSizeY The height of the output buffer, as a number of 1-4 byte cells.
+         * @param filter How the input cells are combined.
+         * @param restriction When not null, restricts the operation to a 2D range of pixels.
+         */
+        void resize(const uint8_t *_Nonnull in, uint8_t *_Nonnull out, size_t inputSizeX,
+                    size_t inputSizeY, size_t vectorSize, size_t outputSizeX, size_t outputSizeY,
+                    ResizeFilter filter, const Restriction *_Nullable restriction = nullptr);
+
         /**
          * The YUV formats supported by yuvToRgb.
          */
@@ -532,6 +649,87 @@ namespace renderscript {
          */
         void yuvToRgb(const uint8_t *_Nonnull in, uint8_t *_Nonnull out, size_t sizeX, size_t sizeY,
                       YuvFormat format);
+
+        /**
+         * The planes of a YUV image whose chroma is subsampled by two in both directions.
+         *
+         * This describes the YUV_420_888 images of android.media.Image, like camera frames,
+         * without copying them. uvPixelStride is the distance in bytes between two samples of a
+         * chroma row: 1 for planar layouts like YV12, 2 for semi-planar ones like NV21 and NV12.
+         */
+        struct YuvPlanes {
+            const uint8_t *_Nonnull y;
+            const uint8_t *_Nonnull u;
+            const uint8_t *_Nonnull v;
+            size_t yRowStride;
+            size_t uvRowStride;
+            size_t uvPixelStride;
+        };
+
+        /**
+         * Convert an image from YUV planes to RGB.
+         *
+         * Same as the yuvToRgb method above, for images whose planes are not laid out as NV21 or
+         * YV12. The output is RGBA; the alpha channel will be set to 255.
+         *
+         * @param planes Where the planes of the image to be converted are.
+         * @param out The buffer that receives the converted image.
+         * @param sizeX The width in pixels of the image.
+         * @param sizeY The height in pixels of the image.
+         */
+        void yuvToRgb(const YuvPlanes &planes, uint8_t *_Nonnull out, size_t sizeX, size_t sizeY);
+
+        /**
+         * Convert an image from YUV planes to RGB and blur it.
+         *
+         * The RGBA image is kept in a buffer of the Toolkit that is reused by later calls, so a
+         * stream of frames can be blurred without the caller holding a converted copy.
+         *
+         * @param planes Where the planes of the image to be converted are.
+         * @param out The buffer that receives the blurred RGBA image.
+         * @param sizeX The width in pixels of the image.
+         * @param sizeY The height in pixels of the image.
+         * @param radius The radius of the pixels used to blur.
+         */
+        void yuvToRgbAndBlur(const YuvPlanes &planes, uint8_t *_Nonnull out, size_t sizeX,
+                             size_t sizeY, int radius);
+
+        /**
+         * The operations of a pipeline() call, done in this order: resize, blur, color matrix
+         * and blend. The defaults skip all of them.
+         */
+        struct PipelineOptions {
+            // The size of the output. The input is resized to it unless both are the same. 0 keeps
+            // the size of the input.
+            size_t outputSizeX = 0;
+            size_t outputSizeY = 0;
+            ResizeFilter resizeFilter = ResizeFilter::AREA;
+            // The radius of the blur, up to 25. 0 skips the blur.
+            float blurRadius = 0.f;
+            // A matrix and an add vector as in colorMatrix(). A null matrix skips the stage.
+            const float *_Nullable colorMatrix = nullptr;
+            const float *_Nullable colorAddVector = nullptr;
+            // The blend of blendColor, as the source, into the image. DST skips the stage.
+            BlendingMode blendMode = BlendingMode::DST;
+            uint8_t blendColor[4] = {0, 0, 0, 0};
+        };
+
+        /**
+         * Resize, blur, transform and blend an RGBA image in a single pass.
+         *
+         * Gives about the same image as calling resize(), blur(), colorMatrix() and blend() in
+         * turn, but each tile of the output goes through all the operations while it is in the
+         * cache of its thread. The intermediate values are not rounded to bytes between the
+         * operations, so the result may differ from the separate calls by one.
+         *
+         * @param in The buffer of the RGBA image to be processed.
+         * @param out The buffer that receives the RGBA image, at the output size of the options.
+         * @param sizeX The width of the input buffer, as a number of 4 byte cells.
+         * @param sizeY The height of the input buffer, as a number of 4 byte cells.
+         * @param options The operations to do.
+         */
+        void pipeline(const uint8_t *_Nonnull in, uint8_t *_Nonnull out, size_t sizeX,
+                      size_t sizeY, const PipelineOptions &options);
     };
 
 }  // namespace renderscript
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "RenderScriptToolkit.h"
+#include "Stages.h"
+#include "TaskProcessor.h"
+#include "Utils.h"
+
+namespace renderscript {
+
+#define LOG_TAG "renderscript.toolkit.Resize"
+
+    using ResizeFilter = RenderScriptToolkit::ResizeFilter;
+
+    ResizeTaps::ResizeTaps(ResizeFilter filter, size_t inSize, size_t outSize) {
+        const float scale = (float) inSize / (float) outSize;
+        const int maxIndex = (int) inSize - 1;
+
+        if (filter == ResizeFilter::AREA) {
+            // Each output cell averages the input cells it covers, weighted by how much of each
+            // it covers. Cells that are only partially covered add one tap on each side.
+            count = (size_t) std::ceil(scale) + 1;
+            indices.resize(outSize * count);
+            weights.resize(outSize * count);
+            for (size_t i = 0; i < outSize; i++) {
+                const float start = (float) i * scale;
+                const float end = std::min((float) (i + 1) * scale, (float) inSize);
+                const int first = (int) start;
+                for (size_t t = 0; t < count; t++) {
+                    const int index = first + (int) t;
+                    const float left = std::max(start, (float) index);
+                    const float right = std::min(end, (float) (index + 1));
+                    indices[i * count + t] = (uint32_t) std::min(index, maxIndex);
+                    weights[i * count + t] = right > left ? (right - left) / scale : 0.f;
+                }
+            }
+            return;
+        }
+
+        // Catmull-Rom bicubic on the centers of the cells, as in the RenderScript intrinsic.
+        count = 4;
+        indices.resize(outSize * count);
+        weights.resize(outSize * count);
+        for (size_t i = 0; i < outSize; i++) {
+            const float position = ((float) i + 0.5f) * scale - 0.5f;
+            const float base = std::floor(position);
+            const float x = position - base;
+            const float x2 = x * x;
+            const float x3 = x2 * x;
+            const float w[4] = {0.5f * (-x + 2.f * x2 - x3),
+                                0.5f * (2.f - 5.f * x2 + 3.f * x3),
+                                0.5f * (x + 4.f * x2 - 3.f * x3),
+                                0.5f * (x3 - x2)};
+            for (size_t t = 0; t < count; t++) {
+                const int index = (int) base - 1 + (int) t;
+                indices[i * count + t] = (uint32_t) std::clamp(index, 0, maxIndex);
+                weights[i * count + t] = w[t];
+            }
+        }
+    }
+
+/**
+ * Resizes an image with a separable filter.
+ *
+ * Each tile first filters the input rows it needs horizontally, keeping them in a small per
+ * thread ring, then combines them vertically. Consecutive output rows share most of their input
+ * rows, so each input row of the tile is filtered horizontally only once.
+ */
+    class ResizeTask : public Task {
+        const uchar *mIn;
+        uchar *mOut;
+        const size_t mInputSizeX;
+        const size_t mInputSizeY;
+        const ResizeTaps mTapsX;
+        const ResizeTaps mTapsY;
+
+        // Per thread: the ring of horizontally filtered rows, and the input row held by each slot.
+        struct Scratch {
+            std::vector<float4> ring;
+            std::vector<uint32_t> rowInSlot;
+        };
+        std::vector<Scratch> mScratch;
+
+        template<typename TF, typename TU>
+        void kernel(int threadIndex, size_t startX, size_t startY, size_t endX, size_t endY);
+
+        // Process a 2D tile of the overall work. threadIndex identifies which thread does the work.
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "Resize"; }
+
+        ResizeTask(const uchar *input, uchar *output, size_t inputSizeX, size_t inputSizeY,
+                   size_t vectorSize, size_t outputSizeX, size_t outputSizeY,
+                   ResizeFilter filter, unsigned int threadCount, const Restriction *restriction)
+                : Task{outputSizeX, outputSizeY, vectorSize, false, restriction},
+                  mIn{input},
+                  mOut{output},
+                  mInputSizeX{inputSizeX},
+                  mInputSizeY{inputSizeY},
+                  mTapsX{filter, inputSizeX, outputSizeX},
+                  mTapsY{filter, inputSizeY, outputSizeY},
+                  mScratch{threadCount} {}
+    };
+
+    template<typename TF>
+    static inline TF roundToByteRange(TF value) {
+        return clamp(value + 0.5f, 0.f, 255.f);
+    }
+
+    template<typename TF, typename TU>
+    void ResizeTask::kernel(int threadIndex, size_t startX, size_t startY, size_t endX,
+                            size_t endY) {
+        const TU *in = reinterpret_cast<const TU *>(mIn);
+        const size_t width = endX - startX;
+        const size_t ringSize = mTapsY.count;
+
+        Scratch &scratch = mScratch[threadIndex];
+        const size_t scratchSize = divideRoundingUp(ringSize * width * sizeof(TF), sizeof(float4));
+        if (scratch.ring.size() < scratchSize) {
+            scratch.ring.resize(scratchSize);
+        }
+        TF *ring = reinterpret_cast<TF *>(scratch.ring.data());
+        // A new tile starts with an empty ring. Only the first tile of the thread allocates.
+        std::vector<uint32_t> &rowInSlot = scratch.rowInSlot;
+        rowInSlot.assign(ringSize, UINT32_MAX);
+
+        for (size_t y = startY; y < endY; y++) {
+            const uint32_t *rowIndices = &mTapsY.indices[y * ringSize];
+            const float *rowWeights = &mTapsY.weights[y * ringSize];
+
+            for (size_t t = 0; t < ringSize; t++) {
+                const uint32_t row = rowIndices[t];
+                const size_t slot = row % ringSize;
+                if (rowInSlot[slot] == row) {
+                    continue;
+                }
+                rowInSlot[slot] = row;
+
+                const TU *inRow = in + row * mInputSizeX;
+                TF *filtered = ring + slot * width;
+                for (size_t x = startX; x < endX; x++) {
+                    const uint32_t *indices = &mTapsX.indices[x * mTapsX.count];
+                    const float *weights = &mTapsX.weights[x * mTapsX.count];
+                    TF sum = 0.f;
+                    for (size_t tx = 0; tx < mTapsX.count; tx++) {
+                        sum += convert<TF>(inRow[indices[tx]]) * weights[tx];
+                    }
+                    filtered[x - startX] = sum;
+                }
+            }
+
+            TU *out = reinterpret_cast<TU *>(mOut) + y * mSizeX + startX;
+            for (size_t x = 0; x < width; x++) {
+                TF sum = 0.f;
+                for (size_t t = 0; t < ringSize; t++) {
+                    sum += ring[(rowIndices[t] % ringSize) * width + x] * rowWeights[t];
+                }
+                out[x] = convert<TU>(roundToByteRange(sum));
+            }
+        }
+    }
+
+    void ResizeTask::processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                                 size_t endY) {
+        switch (mVectorSize) {
+            case 4:
+            case 3:
+                kernel<float4, uchar4>(threadIndex, startX, startY, endX, endY);
+                break;
+            case 2:
+                kernel<float2, uchar2>(threadIndex, startX, startY, endX, endY);
+                break;
+            case 1:
+                kernel<float, uchar>(threadIndex, startX, startY, endX, endY);
+                break;
+        }
+    }
+
+    void RenderScriptToolkit::resize(const uint8_t *input, uint8_t *output, size_t inputSizeX,
+                                     size_t inputSizeY, size_t vectorSize, size_t outputSizeX,
+                                     size_t outputSizeY, const Restriction *restriction) {
+        resize(input, output, inputSizeX, inputSizeY, vectorSize, outputSizeX, outputSizeY,
+               ResizeFilter::BICUBIC, restriction);
+    }
+
+    void RenderScriptToolkit::resize(const uint8_t *input, uint8_t *output, size_t inputSizeX,
+                                     size_t inputSizeY, size_t vectorSize, size_t outputSizeX,
+                                     size_t outputSizeY, ResizeFilter filter,
+                                     const Restriction *restriction) {
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (!validRestriction(LOG_TAG, outputSizeX, outputSizeY, restriction)) {
+            return;
+        }
+        if (vectorSize < 1 || vectorSize > 4) {
+            ALOGE("The vectorSize should be between 1 and 4. %zu provided.", vectorSize);
+            return;
+        }
+#endif
+
+        ResizeTask task(input, output, inputSizeX, inputSizeY, vectorSize, outputSizeX,
+                        outputSizeY, filter, processor->getNumberOfThreads(), restriction);
+        processor->doTask(&task);
+    }
+
+}  // namespace renderscript
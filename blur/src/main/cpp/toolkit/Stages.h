@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RENDERSCRIPT_TOOLKIT_STAGES_H
+#define ANDROID_RENDERSCRIPT_TOOLKIT_STAGES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderScriptToolkit.h"
+#include "Utils.h"
+
+/*
+ * The parts of the single operation tasks that the fused pipeline of Pipeline.cpp reuses, so that
+ * both compute their filters and blends the same way.
+ */
+
+namespace renderscript {
+
+    struct X86Kernels;
+
+// The largest radius BlurTask handles directly, the limit of ScriptIntrinsicBlur.java.
+// RenderScriptToolkit::blur() handles larger ones on a downscaled copy of the image.
+    static constexpr int kMaxBlurTaskRadius = 25;
+
+/**
+ * Computes the 2 * iradius + 1 gaussian weights of a blur, in floating point and in 16.16 fixed
+ * point, and returns iradius. Defined in Blur.cpp.
+ */
+    int computeGaussianWeights(float radius, float *fp, uint16_t *ip);
+
+/**
+ * The taps of a one dimensional filter, for every output index. Defined in Resize.cpp.
+ *
+ * Every output index has the same number of taps so that the loops don't branch. Taps that fall
+ * outside of the input are clamped to its edge, and filters with fewer taps are padded with
+ * zero weights.
+ */
+    struct ResizeTaps {
+        size_t count = 0;
+        // The taps of output index i are at i * count to (i + 1) * count - 1 of both vectors.
+        std::vector<uint32_t> indices;
+        std::vector<float> weights;
+
+        ResizeTaps(RenderScriptToolkit::ResizeFilter filter, size_t inSize, size_t outSize);
+    };
+
+/**
+ * Blends length cells of in into out, as RenderScriptToolkit::blend() does. Defined in Blend.cpp.
+ *
+ * x86Kernels is the table of the task on x86 when it uses SIMD, and null otherwise.
+ */
+    void blendRow(RenderScriptToolkit::BlendingMode mode, const uchar4 *in, uchar4 *out,
+                  uint32_t length, const X86Kernels *x86Kernels);
+
+}  // namespace renderscript
+
+#endif  // ANDROID_RENDERSCRIPT_TOOLKIT_STAGES_H
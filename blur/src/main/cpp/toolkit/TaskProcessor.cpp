@@ -16,8 +16,15 @@
 
 #include "TaskProcessor.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <climits>
+#include <functional>
+#include <linux/futex.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "RenderScriptToolkit.h"
 #include "Utils.h"
@@ -26,6 +33,51 @@
 
 namespace renderscript {
 
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex needs a plain int");
+
+    /**
+     * How long a thread spins on its condition before parking: about the time it takes the client
+     * thread to start the next task of a multi-pass operation, and much less than a tile. Bounded by
+     * time rather than by a count of cpuRelax(), which takes from a few cycles (yield on most Arm
+     * cores) to about 140 (pause on Skylake and later x86 cores).
+     */
+    static constexpr std::chrono::microseconds kSpinTime{10};
+
+    // cpuRelax() calls between two reads of the clock, which takes a few tens of nanoseconds.
+    static constexpr int kSpinsPerClockRead = 16;
+
+    static inline void cpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+
+    // Spins until done() returns true or kSpinTime has passed, and returns the last done().
+    template<typename Done>
+    static bool spinUntil(Done done) {
+        const auto deadline = std::chrono::steady_clock::now() + kSpinTime;
+        while (true) {
+            for (int spin = 0; spin < kSpinsPerClockRead; spin++) {
+                if (done()) return true;
+                cpuRelax();
+            }
+            if (std::chrono::steady_clock::now() >= deadline) return done();
+        }
+    }
+
+    // Parks the thread while *address is expected. Returns right away if it already isn't.
+    static void futexWait(std::atomic<int> *address, int expected) {
+        syscall(__NR_futex, reinterpret_cast<int *>(address), FUTEX_WAIT_PRIVATE, expected,
+                nullptr, nullptr, 0);
+    }
+
+    static void futexWake(std::atomic<int> *address, int count) {
+        syscall(__NR_futex, reinterpret_cast<int *>(address), FUTEX_WAKE_PRIVATE, count, nullptr,
+                nullptr, 0);
+    }
+
     int Task::setTiling(unsigned int targetTileSizeInBytes) {
         // Empirically, values smaller than 1000 are unlikely to give good performance.
         targetTileSizeInBytes = std::max(1000u, targetTileSizeInBytes);
@@ -54,13 +106,22 @@ namespace renderscript {
         mCellsPerTileX = divideRoundingUp(cellsToProcessX, mTilesPerRow);
 
         // We do the same thing for the Y direction.
-        size_t targetRowsPerTile = divideRoundingUp(targetCellsPerTile, mCellsPerTileX);
+        size_t targetRowsPerTile =
+                std::max(mMinRowsPerTile, divideRoundingUp(targetCellsPerTile, mCellsPerTileX));
         mTilesPerColumn = divideRoundingUp(cellsToProcessY, targetRowsPerTile);
         mCellsPerTileY = divideRoundingUp(cellsToProcessY, mTilesPerColumn);
 
         return mTilesPerRow * mTilesPerColumn;
     }
 
+    size_t Task::sizeInBytes() const {
+        if (mRestriction == nullptr) {
+            return mSizeX * mSizeY * paddedSize(mVectorSize);
+        }
+        return (mRestriction->endX - mRestriction->startX) *
+               (mRestriction->endY - mRestriction->startY) * paddedSize(mVectorSize);
+    }
+
     void Task::processTile(unsigned int threadIndex, size_t tileIndex) {
         // Figure out the overall boundaries.
         size_t startWorkX;
@@ -99,121 +160,150 @@ namespace renderscript {
 
     TaskProcessor::TaskProcessor(unsigned int numThreads)
             : mUsesSimd{cpuSupportsSimd()},
-            /* If the requested number of threads is 0, we'll decide based on the number of cores.
-             * Through empirical testing, we've found that using more than 6 threads does not help.
-             * There may be more optimal choices to make depending on the SoC but we'll stick to
-             * this simple heuristic for now.
+#if defined(ARCH_X86_HAVE_SSSE3)
+              mX86Kernels{selectX86Kernels()},
+#endif
+            /* If the requested number of threads is 0, we'll use one per core. The pool threads are
+             * cheap while parked: mTuner decides how many of them each task wakes, depending on the
+             * size of its work and on how previous tasks of the same kind went.
              *
              * We'll re-use the thread that calls the processor doTask method, so we'll spawn one less
              * worker pool thread than the total number of threads.
              */
-              mNumberOfPoolThreads{numThreads ? numThreads - 1
-                                              : std::min(6u, std::thread::hardware_concurrency() - 1)} {
+              mNumberOfPoolThreads{
+                      numThreads ? numThreads - 1
+                                 : std::max(1u, std::thread::hardware_concurrency()) - 1},
+              mTuner{mNumberOfPoolThreads + 1} {
         for (size_t i = 0; i < mNumberOfPoolThreads; i++) {
-            mPoolThreads.emplace_back(
-                    std::bind(&TaskProcessor::processTilesOfWork, this, i + 1, false));
+            mPoolThreads.emplace_back(std::bind(&TaskProcessor::runPoolThread, this, i + 1));
         }
     }
 
     TaskProcessor::~TaskProcessor() {
-        {
-            std::lock_guard<std::mutex> lock(mQueueMutex);
-            mStopThreads = true;
-            mWorkAvailableOrStop.notify_all();
-        }
+        mStopThreads.store(true);
+        mWorkGeneration.fetch_add(1);
+        futexWake(&mWorkGeneration, INT_MAX);
 
         for (auto &thread: mPoolThreads) {
             thread.join();
         }
     }
 
-    void TaskProcessor::processTilesOfWork(int threadIndex, bool returnWhenNoWork) {
-        if (threadIndex != 0) {
-            // Set the name of the thread, except for thread 0, which is not part of the pool.
-            // PR_SET_NAME takes a maximum of 16 characters, including the terminating null.
-            char name[16]{"RenderScToolkit"};
-            prctl(PR_SET_NAME, name, 0, 0, 0);
-            // ALOGI("Starting thread%d", threadIndex);
-        }
+    void TaskProcessor::runPoolThread(int threadIndex) {
+        // Set the name of the thread. PR_SET_NAME takes a maximum of 16 characters, including the
+        // terminating null.
+        char name[16]{"RenderScToolkit"};
+        prctl(PR_SET_NAME, name, 0, 0, 0);
+        // ALOGI("Starting thread%d", threadIndex);
 
-        std::unique_lock<std::mutex> lock(mQueueMutex);
+        int seenGeneration = 0;
         while (true) {
-            mWorkAvailableOrStop.wait(lock, [this, returnWhenNoWork]() /*REQUIRES(mQueueMutex)*/ {
-                return mStopThreads || (mTilesNotYetStarted > 0) ||
-                       (returnWhenNoWork && (mTilesNotYetStarted == 0));
+            int generation;
+            spinUntil([&] {
+                generation = mWorkGeneration.load(std::memory_order_acquire);
+                return generation != seenGeneration;
             });
+            while (generation == seenGeneration) {
+                // Both this increment and the one of startWork() are sequentially consistent, so
+                // either startWork() sees that we're parked, or the futex sees the new generation.
+                mParkedThreads.fetch_add(1);
+                futexWait(&mWorkGeneration, seenGeneration);
+                mParkedThreads.fetch_sub(1);
+                generation = mWorkGeneration.load(std::memory_order_acquire);
+            }
+            seenGeneration = generation;
             // ALOGI("Woke thread%d", threadIndex);
 
-            // This ScopedLockAssertion is to help the compiler when it checks thread annotations
-            // to realize that we have the lock. It's however not completely true; we don't
-            // hold the lock while processing the tile.
-            // TODO Figure out how to fix that.
-            // android::base::ScopedLockAssertion lockAssert(mQueueMutex);
-            if (mStopThreads || (returnWhenNoWork && mTilesNotYetStarted == 0)) {
+            if (mStopThreads.load(std::memory_order_acquire)) {
                 break;
             }
+            if (mHelpersWanted.fetch_sub(1, std::memory_order_relaxed) > 0) {
+                processTilesOfWork(threadIndex);
+            }
+        }
+        // ALOGI("Ending thread%d", threadIndex);
+    }
 
-            while (mTilesNotYetStarted > 0 && !mStopThreads) {
-                // This picks the tiles in decreasing order but that does not matter.
-                int myTile = --mTilesNotYetStarted;
-                mTilesInProcess++;
-                lock.unlock();
-                {
-                    // We won't be executing this code unless the main thread is
-                    // holding the mTaskMutex lock, which guards mCurrentTask.
-                    // The compiler can't figure this out.
-                    // android::base::ScopedLockAssertion lockAssert(mTaskMutex);
-                    mCurrentTask->processTile(threadIndex, myTile);
-                }
-                lock.lock();
-                mTilesInProcess--;
-                if (mTilesInProcess == 0 && mTilesNotYetStarted == 0) {
-                    mWorkIsFinished.notify_one();
-                }
+    void TaskProcessor::processTilesOfWork(int threadIndex) {
+        while (true) {
+            // This picks the tiles in decreasing order but that does not matter. A pool thread
+            // that gets here late may claim a tile of the next task. That's fine: the task is
+            // published before its tiles are, and it isn't done until that tile is finished.
+            const int myTile = mTilesNotYetStarted.fetch_sub(1, std::memory_order_acquire) - 1;
+            if (myTile < 0) {
+                break;
+            }
+            {
+                // We won't be executing this code unless the main thread is
+                // holding the mTaskMutex lock, which guards mCurrentTask.
+                // The compiler can't figure this out.
+                // android::base::ScopedLockAssertion lockAssert(mTaskMutex);
+                mCurrentTask->processTile(threadIndex, myTile);
+            }
+            if (mTilesNotYetFinished.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+                threadIndex != 0) {
+                futexWake(&mTilesNotYetFinished, 1);
             }
         }
-        // if (threadIndex != 0) {
-        //     ALOGI("Ending thread%d", threadIndex);
-        // }
     }
 
     void TaskProcessor::doTask(Task *task) {
         std::lock_guard<std::mutex> lockGuard(mTaskMutex);
         task->setUsesSimd(mUsesSimd);
+#if defined(ARCH_X86_HAVE_SSSE3)
+        task->setX86Kernels(mX86Kernels);
+#endif
         mCurrentTask = task;
+        const size_t sizeInBytes = task->sizeInBytes();
+        const TaskTuner::Choice choice = mTuner.choose(task->name(), sizeInBytes);
+        const auto start = std::chrono::steady_clock::now();
         // Notify the thread pool of available work.
-        startWork(task);
+        startWork(task, choice);
         // Start processing some of the tiles on the calling thread.
-        processTilesOfWork(0, true);
+        processTilesOfWork(0);
         // Wait for all the pool workers to complete.
         waitForPoolWorkersToComplete();
+        mTuner.record(task->name(), sizeInBytes, choice, std::chrono::steady_clock::now() - start);
         mCurrentTask = nullptr;
     }
 
-    void TaskProcessor::startWork(Task *task) {
+    void TaskProcessor::startWork(Task *task, TaskTuner::Choice choice) {
         /**
-         * The size in bytes that we're hoping each tile will be. If this value is too small,
-         * we'll spend too much time in synchronization. If it's too large, some cores may be
-         * idle while others still have a lot of work to do. Ideally, it would depend on the
-         * device we're running. 16k is the same value used by RenderScript and seems reasonable
-         * from ad-hoc tests.
+         * The size in bytes that we're hoping each tile will be comes from mTuner. If it is too
+         * small, we'll spend too much time in synchronization. If it's too large, some cores may
+         * be idle while others still have a lot of work to do.
          */
-        const size_t targetTileSize = 16 * 1024;
-
-        std::lock_guard<std::mutex> lock(mQueueMutex);
-        assert(mTilesInProcess == 0);
-        mTilesNotYetStarted = task->setTiling(targetTileSize);
-        mWorkAvailableOrStop.notify_all();
+        assert(mTilesNotYetFinished.load() == 0);
+        const int tileCount = task->setTiling(choice.tileSizeInBytes);
+        // The calling thread is one of the threads of the choice.
+        const int helpers = std::min<int>({static_cast<int>(choice.threadCount), tileCount,
+                                           static_cast<int>(mNumberOfPoolThreads) + 1}) - 1;
+        mTilesNotYetFinished.store(tileCount, std::memory_order_relaxed);
+        mHelpersWanted.store(helpers, std::memory_order_relaxed);
+        // Releases mCurrentTask and the tiling to the threads that claim a tile.
+        mTilesNotYetStarted.store(tileCount, std::memory_order_release);
+        if (helpers == 0) {
+            // Small tasks are done on the calling thread alone, without waking anyone.
+            return;
+        }
+        mWorkGeneration.fetch_add(1);
+        if (mParkedThreads.load() > 0) {
+            futexWake(&mWorkGeneration, helpers);
+        }
     }
 
     void TaskProcessor::waitForPoolWorkersToComplete() {
-        std::unique_lock<std::mutex> lock(mQueueMutex);
-        // The predicate, i.e. the lambda, will make sure that
-        // we terminate even if the main thread calls this after
-        // mWorkIsFinished is signaled.
-        mWorkIsFinished.wait(lock, [this]() /*REQUIRES(mQueueMutex)*/ {
-            return mTilesNotYetStarted == 0 && mTilesInProcess == 0;
+        int tilesLeft;
+        spinUntil([&] {
+            tilesLeft = mTilesNotYetFinished.load(std::memory_order_acquire);
+            return tilesLeft == 0;
         });
+        // The futex returns right away if a pool thread finished a tile in the meantime, so we
+        // can't miss the wake of the last one.
+        while (tilesLeft != 0) {
+            futexWait(&mTilesNotYetFinished, tilesLeft);
+            tilesLeft = mTilesNotYetFinished.load(std::memory_order_acquire);
+        }
     }
 
 }  // namespace renderscript
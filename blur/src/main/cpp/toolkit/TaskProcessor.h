@@ -20,12 +20,17 @@
 // #include <android-base/thread_annotations.h>
 
 #include <atomic>
-#include <condition_variable>
 #include <cstddef>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include "TaskTuner.h"
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+#include "X86Kernels.h"
+#endif
+
 namespace renderscript {
 
 /**
@@ -68,10 +73,21 @@ namespace renderscript {
          * processed.
          */
         const bool mPrefersDataAsOneRow;
+        /**
+         * The fewest rows a tile should have. Tasks that recompute a margin of rows around each
+         * tile raise it, so that the margin stays small next to the rows the tile produces.
+         */
+        size_t mMinRowsPerTile = 1;
         /**
          * Whether the processor we're working on supports SIMD operations.
          */
         bool mUsesSimd = false;
+#if defined(ARCH_X86_HAVE_SSSE3)
+        /**
+         * The x86 kernels of the widest vector size the processor supports. Set when mUsesSimd is.
+         */
+        const X86Kernels *mX86Kernels = nullptr;
+#endif
 
     private:
         /**
@@ -118,8 +134,22 @@ namespace renderscript {
 
         virtual ~Task() {}
 
+        /**
+         * The name of the kind of task, e.g. "Blend". The TaskTuner learns a tiling per name.
+         */
+        virtual const char *name() const = 0;
+
+        /**
+         * The number of bytes of the cells to process, i.e. within the restriction if any.
+         */
+        size_t sizeInBytes() const;
+
         void setUsesSimd(bool uses) { mUsesSimd = uses; }
 
+#if defined(ARCH_X86_HAVE_SSSE3)
+        void setX86Kernels(const X86Kernels *kernels) { mX86Kernels = kernels; }
+#endif
+
         /**
          * Divide the work into a number of tiles that can be distributed to the various threads.
          * A tile will be a rectangular region. To be robust, we'll want to handle regular cases
@@ -162,19 +192,25 @@ namespace renderscript {
          * Does this processor support SIMD-like instructions?
          */
         const bool mUsesSimd;
+#if defined(ARCH_X86_HAVE_SSSE3)
+        /**
+         * The x86 kernels the tasks call, chosen once for the CPU we run on.
+         */
+        const X86Kernels *const mX86Kernels;
+#endif
         /**
          * The number of separate threads we'll spawn. It's one less than the number of threads that
          * do the work as the client thread that starts the work will also be used.
          */
         const unsigned int mNumberOfPoolThreads;
         /**
-         * Ensures that only one task is done at a time.
+         * Picks the tiling and the number of threads of each task.
          */
-        std::mutex mTaskMutex;
+        TaskTuner mTuner;
         /**
-         * Ensures consistent access to the shared queue state.
+         * Ensures that only one task is done at a time.
          */
-        std::mutex mQueueMutex;
+        std::mutex mTaskMutex;
         /**
          * The thread pool workers.
          */
@@ -182,53 +218,69 @@ namespace renderscript {
         /**
          * The task being processed, if any. We only do one task at a time. We could create a queue
          * of tasks but using a mTaskMutex is sufficient for now.
+         *
+         * Written before mTilesNotYetStarted is released, so a thread that claims a tile sees it.
          */
         Task *mCurrentTask /*GUARDED_BY(mTaskMutex)*/ = nullptr;
         /**
-         * Signals that the mPoolThreads should terminate.
+         * A user task, e.g. a blend or a blur, is split into a number of tiles. A thread claims the
+         * next tile to work on by decrementing this count. The tile number is sufficient to
+         * determine the boundaries of the data to process. The count goes negative once all the
+         * tiles have been claimed, as every thread decrements it once more to find out.
+         *
+         * The tiles are claimed without a lock, so that threads don't contend on every tile.
          */
-        bool mStopThreads /*GUARDED_BY(mQueueMutex)*/ = false;
+        std::atomic<int> mTilesNotYetStarted{0};
         /**
-         * Signaled when work is available or the mPoolThreads need to shut down. mStopThreads is used
-         * to distinguish between the two.
+         * The number of tiles of the current task that are not finished. The thread that finishes
+         * the last one wakes the thread waiting in waitForPoolWorkersToComplete(), if it's not
+         * that thread itself.
          */
-        std::condition_variable mWorkAvailableOrStop;
+        std::atomic<int> mTilesNotYetFinished{0};
         /**
-         * Signaled when the work for the task is finished.
+         * Incremented when work is available or the mPoolThreads need to shut down. mStopThreads is
+         * used to distinguish between the two. Idle pool threads park on it.
          */
-        std::condition_variable mWorkIsFinished;
+        std::atomic<int> mWorkGeneration{0};
         /**
-         * A user task, e.g. a blend or a blur, is split into a number of tiles. When a thread starts
-         * working on a new tile, it uses this count to identify which tile to work on. The tile
-         * number is sufficient to determine the boundaries of the data to process.
-         *
-         * The number of tiles left to process.
+         * The number of pool threads that should help with the current task, as chosen by mTuner.
+         * Each pool thread that wakes for a task takes one; those that find none left go back to
+         * waiting.
          */
-        int mTilesNotYetStarted /*GUARDED_BY(mQueueMutex)*/ = 0;
+        std::atomic<int> mHelpersWanted{0};
         /**
-         * The number of tiles currently being processed. Must not be greater than
-         * mNumberOfPoolThreads + 1.
+         * The number of pool threads parked on mWorkGeneration, so that starting a task only makes
+         * a system call when one of them needs waking.
          */
-        int mTilesInProcess /*GUARDED_BY(mQueueMutex)*/ = 0;
+        std::atomic<int> mParkedThreads{0};
+        /**
+         * Signals that the mPoolThreads should terminate.
+         */
+        std::atomic<bool> mStopThreads{false};
 
         /**
          * Determines how we'll tile the work and signals the thread pool of available work.
          *
          * @param task The task to be performed.
+         * @param choice The tile size and the number of threads to use.
          */
-        void startWork(Task *task) /*REQUIRES(mTaskMutex)*/;
+        void startWork(Task *task, TaskTuner::Choice choice) /*REQUIRES(mTaskMutex)*/;
 
         /**
-         * Tells the thread to start processing work off the queue.
+         * The loop of a pool thread: waits for a task, helps with its tiles, and waits again until
+         * the processor is destroyed. A thread spins for a short while before parking, as the
+         * Toolkit methods often run several tasks back to back.
          *
-         * The flag is used for prevent the main thread from blocking forever if the work is
-         * so trivial that the worker threads complete the work before the main thread calls this
-         * method.
+         * @param threadIndex The index number (1..mNumberOfPoolThreads) this thread will referred by.
+         */
+        void runPoolThread(int threadIndex);
+
+        /**
+         * Processes tiles of the current task until all of them have been claimed.
          *
          * @param threadIndex The index number (0..mNumberOfPoolThreads) this thread will referred by.
-         * @param returnWhenNoWork If there's no work, return immediately.
          */
-        void processTilesOfWork(int threadIndex, bool returnWhenNoWork);
+        void processTilesOfWork(int threadIndex);
 
         /**
          * Wait for the pool workers to complete the work on the current task.
@@ -256,6 +308,16 @@ namespace renderscript {
          * This provides the number of threads.
          */
         unsigned int getNumberOfThreads() const { return mNumberOfPoolThreads + 1; }
+
+        /**
+         * Loads the tilings learned in a previous run. See TaskTuner::load().
+         */
+        bool loadTuning(const char *path) { return mTuner.load(path); }
+
+        /**
+         * Saves the tilings learned so far. See TaskTuner::save().
+         */
+        bool saveTuning(const char *path) { return mTuner.save(path); }
     };
 
 }  // namespace renderscript
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TaskTuner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "Utils.h"
+
+#define LOG_TAG "renderscript.toolkit.TaskTuner"
+
+namespace renderscript {
+
+    // Used when the kernel does not tell us the size of the L2 cache.
+    static constexpr size_t kDefaultL2CacheSize = 512 * 1024;
+    static constexpr unsigned int kMinTileSize = 4 * 1024;
+    static constexpr unsigned int kMaxTileSize = 256 * 1024;
+    // Below this much data per thread, waking a thread costs about as much as it saves.
+    static constexpr size_t kMinBytesPerThread = 64 * 1024;
+    // One call in kExploreInterval tries a neighbor of the best choice.
+    static constexpr uint32_t kExploreInterval = 8;
+    // A choice replaces the best one once it is measured this many times and is this much faster.
+    static constexpr uint32_t kMinSamples = 2;
+    static constexpr float kMinImprovement = 0.95f;
+    static constexpr float kAverageWeight = 0.25f;
+    static constexpr uint32_t kNeighborCount = 4;
+
+    static constexpr char kFileHeader[] = "renderscript-toolkit-tuning";
+    static constexpr int kFileVersion = 1;
+
+    /**
+     * Returns the largest L2 cache of the cores, as listed in sysfs, or 0 if it's not there. The
+     * cores of a big.LITTLE SoC have different caches, and the work runs mostly on the big ones.
+     */
+    static size_t readL2CacheSize() {
+        const unsigned int cpuCount = std::max(1u, std::thread::hardware_concurrency());
+        size_t largest = 0;
+        for (unsigned int cpu = 0; cpu < cpuCount; cpu++) {
+            for (int index = 0; index < 8; index++) {
+                char path[96];
+                snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%d/level",
+                         cpu, index);
+                FILE *file = fopen(path, "r");
+                if (file == nullptr) {
+                    break;
+                }
+                int level = 0;
+                const bool hasLevel = fscanf(file, "%d", &level) == 1;
+                fclose(file);
+                if (!hasLevel || level != 2) {
+                    continue;
+                }
+
+                snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%d/size",
+                         cpu, index);
+                file = fopen(path, "r");
+                if (file == nullptr) {
+                    continue;
+                }
+                size_t size = 0;
+                char unit = 0;
+                const int count = fscanf(file, "%zu%c", &size, &unit);
+                fclose(file);
+                if (count == 2 && unit == 'K') {
+                    size *= 1024;
+                } else if (count == 2 && unit == 'M') {
+                    size *= 1024 * 1024;
+                }
+                largest = std::max(largest, size);
+            }
+        }
+        return largest;
+    }
+
+    static int sizeBucket(size_t sizeInBytes) {
+        int bucket = 0;
+        while (sizeInBytes > 1) {
+            sizeInBytes >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    TaskTuner::TaskTuner(unsigned int maxThreads)
+            : mMaxThreads{std::max(1u, maxThreads)},
+              mL2CacheSize{[] {
+                  const size_t size = readL2CacheSize();
+                  return size > 0 ? size : kDefaultL2CacheSize;
+              }()} {}
+
+    TaskTuner::Choice TaskTuner::initialChoice(size_t sizeInBytes) const {
+        // A tile is read and written, often with a few rows of neighbors, while the other threads
+        // of the cluster share the cache. A 32nd of the L2 is 16KB on a 512KB L2, the size
+        // RenderScript used.
+        const auto tileSize = static_cast<unsigned int>(
+                std::clamp(mL2CacheSize / 32, size_t{kMinTileSize}, size_t{64 * 1024}));
+        const auto threadCount = static_cast<unsigned int>(
+                std::clamp(sizeInBytes / kMinBytesPerThread, size_t{1}, size_t{mMaxThreads}));
+        return {tileSize, threadCount};
+    }
+
+    bool TaskTuner::neighborOf(Choice choice, uint32_t i, Choice *neighbor) const {
+        *neighbor = choice;
+        switch (i) {
+            case 0:
+                neighbor->tileSizeInBytes = choice.tileSizeInBytes * 2;
+                return neighbor->tileSizeInBytes <= kMaxTileSize;
+            case 1:
+                neighbor->tileSizeInBytes = choice.tileSizeInBytes / 2;
+                return neighbor->tileSizeInBytes >= kMinTileSize;
+            case 2:
+                neighbor->threadCount = std::min(mMaxThreads, (choice.threadCount * 3 + 1) / 2);
+                return neighbor->threadCount != choice.threadCount;
+            default:
+                neighbor->threadCount = std::max(1u, choice.threadCount * 2 / 3);
+                return neighbor->threadCount != choice.threadCount;
+        }
+    }
+
+    TaskTuner::Choice TaskTuner::choose(const char *taskName, size_t sizeInBytes) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto inserted = mEntries.try_emplace({taskName, sizeBucket(sizeInBytes)});
+        Entry &entry = inserted.first->second;
+        if (inserted.second) {
+            entry.best = initialChoice(sizeInBytes);
+        }
+
+        entry.calls++;
+        // Measure the best choice a few times before comparing anything to it.
+        if (entry.calls <= kMinSamples || entry.calls % kExploreInterval != 0) {
+            return entry.best;
+        }
+        for (uint32_t tries = 0; tries < kNeighborCount; tries++) {
+            Choice neighbor;
+            const uint32_t i = entry.nextNeighbor++ % kNeighborCount;
+            if (neighborOf(entry.best, i, &neighbor)) {
+                return neighbor;
+            }
+        }
+        return entry.best;
+    }
+
+    void TaskTuner::record(const char *taskName, size_t sizeInBytes, Choice choice,
+                           std::chrono::nanoseconds duration) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto found = mEntries.find({taskName, sizeBucket(sizeInBytes)});
+        if (found == mEntries.end()) {
+            return;
+        }
+        Entry &entry = found->second;
+
+        const float nanosPerByte = static_cast<float>(duration.count()) /
+                                   static_cast<float>(std::max<size_t>(1, sizeInBytes));
+        Stats &stats = entry.stats[packChoice(choice)];
+        stats.nanosPerByte = stats.samples == 0
+                             ? nanosPerByte
+                             : stats.nanosPerByte +
+                               kAverageWeight * (nanosPerByte - stats.nanosPerByte);
+        stats.samples++;
+
+        const uint32_t bestKey = packChoice(entry.best);
+        if (packChoice(choice) == bestKey || stats.samples < kMinSamples) {
+            return;
+        }
+        const Stats &bestStats = entry.stats[bestKey];
+        if (bestStats.samples >= kMinSamples &&
+            stats.nanosPerByte < kMinImprovement * bestStats.nanosPerByte) {
+            entry.best = choice;
+            // Compare the new neighbors from scratch. The old ones were measured long ago.
+            const Stats kept = stats;
+            entry.stats.clear();
+            entry.stats[packChoice(choice)] = kept;
+        }
+    }
+
+    bool TaskTuner::load(const char *path) {
+        FILE *file = fopen(path, "r");
+        if (file == nullptr) {
+            return false;
+        }
+        char header[32];
+        int version = 0;
+        unsigned int maxThreads = 0;
+        size_t l2CacheSize = 0;
+        if (fscanf(file, "%31s %d %u %zu", header, &version, &maxThreads, &l2CacheSize) != 4 ||
+            strcmp(header, kFileHeader) != 0 || version != kFileVersion ||
+            maxThreads != mMaxThreads || l2CacheSize != mL2CacheSize) {
+            fclose(file);
+            return false;
+        }
+
+        std::map<std::pair<std::string, int>, Entry> entries;
+        char name[64];
+        int bucket;
+        Choice choice;
+        Stats stats;
+        while (fscanf(file, "%63s %d %u %u %f", name, &bucket, &choice.tileSizeInBytes,
+                      &choice.threadCount, &stats.nanosPerByte) == 5) {
+            if (choice.tileSizeInBytes < kMinTileSize || choice.tileSizeInBytes > kMaxTileSize ||
+                choice.threadCount < 1 || choice.threadCount > mMaxThreads) {
+                continue;
+            }
+            Entry &entry = entries[{name, bucket}];
+            entry.best = choice;
+            // Start exploring right away, the device may be used differently than last time.
+            entry.calls = kMinSamples;
+            stats.samples = kMinSamples;
+            entry.stats[packChoice(choice)] = stats;
+        }
+        fclose(file);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries = std::move(entries);
+        return true;
+    }
+
+    bool TaskTuner::save(const char *path) {
+        FILE *file = fopen(path, "w");
+        if (file == nullptr) {
+            ALOGE("Can't write the tuning file %s.", path);
+            return false;
+        }
+        fprintf(file, "%s %d %u %zu\n", kFileHeader, kFileVersion, mMaxThreads, mL2CacheSize);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (const auto &[key, entry]: mEntries) {
+                auto stats = entry.stats.find(packChoice(entry.best));
+                if (stats == entry.stats.end() || stats->second.samples == 0) {
+                    continue;
+                }
+                fprintf(file, "%s %d %u %u %g\n", key.first.c_str(), key.second,
+                        entry.best.tileSizeInBytes, entry.best.threadCount,
+                        stats->second.nanosPerByte);
+            }
+        }
+        return fclose(file) == 0;
+    }
+
+}  // namespace renderscript
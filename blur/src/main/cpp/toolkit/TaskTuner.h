@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RENDERSCRIPT_TOOLKIT_TASKTUNER_H
+#define ANDROID_RENDERSCRIPT_TOOLKIT_TASKTUNER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace renderscript {
+
+/**
+ * Picks the tile size and the number of threads of each task, and learns from how long the tasks
+ * take.
+ *
+ * The choices are kept per task type, e.g. "Blend", and per power of two of the number of bytes
+ * processed. The first choice for a size follows from the L2 cache size and the core count: tiles
+ * small enough that the input and output of a tile stay in L2, and one thread per 64KB of data so
+ * that small images don't wake the whole pool for a few microseconds of work. From there, one
+ * call in kExploreInterval tries a neighboring choice, a tile twice as large or small or a few
+ * more or fewer threads, and the tuner moves to it once it has been measured faster.
+ *
+ * The choices can be saved to a file and loaded back the next time the application starts. The
+ * file records the core count and the L2 cache size, and is ignored on a different device.
+ *
+ * The TaskProcessor calls choose() and record() while it holds its task mutex. load() and save()
+ * can be called from any thread.
+ */
+    class TaskTuner {
+    public:
+        struct Choice {
+            unsigned int tileSizeInBytes;
+            unsigned int threadCount;
+        };
+
+        /**
+         * @param maxThreads The number of threads of the processor, including the client thread.
+         */
+        explicit TaskTuner(unsigned int maxThreads);
+
+        /**
+         * Returns how to tile the next task named taskName that processes sizeInBytes bytes.
+         */
+        Choice choose(const char *taskName, size_t sizeInBytes);
+
+        /**
+         * Records how long the task took with the choice that choose() returned.
+         */
+        void record(const char *taskName, size_t sizeInBytes, Choice choice,
+                    std::chrono::nanoseconds duration);
+
+        /**
+         * Replaces the learned choices by those saved in the file. Returns false if the file can't
+         * be read or was saved on another device, in which case the choices are left unchanged.
+         */
+        bool load(const char *path);
+
+        /**
+         * Saves the learned choices to the file. Returns false if it can't be written.
+         */
+        bool save(const char *path);
+
+    private:
+        struct Stats {
+            // Exponential moving average of the time per byte.
+            float nanosPerByte = 0.f;
+            uint32_t samples = 0;
+        };
+
+        struct Entry {
+            Choice best;
+            uint32_t calls = 0;
+            // Which neighbor of best to try next.
+            uint32_t nextNeighbor = 0;
+            // The measurements of best and of the neighbors tried, keyed by packChoice().
+            std::map<uint32_t, Stats> stats;
+        };
+
+        const unsigned int mMaxThreads;
+        const size_t mL2CacheSize;
+        std::mutex mMutex;
+        // Keyed by the task name and the log2 of its size in bytes.
+        std::map<std::pair<std::string, int>, Entry> mEntries /*GUARDED_BY(mMutex)*/;
+
+        Choice initialChoice(size_t sizeInBytes) const;
+
+        /**
+         * Returns neighbor i of the choice, or false if it is out of the range of choices.
+         */
+        bool neighborOf(Choice choice, uint32_t i, Choice *neighbor) const;
+
+        static uint32_t packChoice(Choice choice) {
+            return (choice.tileSizeInBytes / 1024) << 8 | choice.threadCount;
+        }
+    };
+
+}  // namespace renderscript
+
+#endif  // ANDROID_RENDERSCRIPT_TOOLKIT_TASKTUNER_H
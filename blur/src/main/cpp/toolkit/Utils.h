@@ -90,6 +90,16 @@ namespace renderscript {
         return (float) i;
     }
 
+    template<>
+    inline uchar convert(int i) {
+        return (uchar) i;
+    }
+
+    template<>
+    inline int convert(uchar i) {
+        return (int) i;
+    }
+
     inline int4 clamp(int4 amount, int low, int high) {
         int4 r;
         r.x = amount.x < low ? low : (amount.x > high ? high : amount.x);
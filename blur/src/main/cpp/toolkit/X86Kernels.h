@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RENDERSCRIPT_TOOLKIT_X86_KERNELS_H
+#define ANDROID_RENDERSCRIPT_TOOLKIT_X86_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace renderscript {
+
+/**
+ * The x86 kernels that exist for several vector widths.
+ *
+ * x86.cpp has the SSSE3 versions, which every x86 ABI supports. x86_avx2.cpp and x86_avx512.cpp
+ * are compiled with the flags of their extension and provide 256 and 512 bit versions. The
+ * TaskProcessor picks the widest table the CPU supports when it is created, and the tasks call
+ * through it. All the versions of a kernel give identical results.
+ *
+ * The counts are in the units of the SSSE3 kernels: bytes for the blur, blocks of four pixels for
+ * the color matrix and blocks of eight pixels for the blend and the YUV conversion. The wider
+ * kernels hand the last blocks that don't fill one of their vectors to the SSSE3 versions.
+ */
+    struct X86Kernels {
+        // The most taps the blur kernels are called with, 2 * 25 + 1.
+        static constexpr int kMaxBlurTaps = 51;
+
+        void (*blurVU)(uint16_t *dst, const uint8_t *const *rows, const uint16_t *ip, int rct,
+                       size_t count);
+        void (*blurHU)(uint8_t *dst, const uint16_t *src, size_t step, const uint16_t *ip, int rct,
+                       size_t count);
+
+        void (*colorMatrix4x4)(void *dst, const void *src, const short *coef, uint32_t count);
+        void (*colorMatrix3x3)(void *dst, const void *src, const short *coef, uint32_t count);
+        void (*colorMatrixDot)(void *dst, const void *src, const short *coef, uint32_t count);
+
+        void (*blendSrcOver)(void *dst, const void *src, uint32_t count8);
+        void (*blendDstOver)(void *dst, const void *src, uint32_t count8);
+        void (*blendSrcIn)(void *dst, const void *src, uint32_t count8);
+        void (*blendDstIn)(void *dst, const void *src, uint32_t count8);
+        void (*blendSrcOut)(void *dst, const void *src, uint32_t count8);
+        void (*blendDstOut)(void *dst, const void *src, uint32_t count8);
+        void (*blendSrcAtop)(void *dst, const void *src, uint32_t count8);
+        void (*blendDstAtop)(void *dst, const void *src, uint32_t count8);
+        void (*blendXor)(void *dst, const void *src, uint32_t count8);
+        void (*blendMultiply)(void *dst, const void *src, uint32_t count8);
+        void (*blendAdd)(void *dst, const void *src, uint32_t count8);
+        void (*blendSub)(void *dst, const void *src, uint32_t count8);
+
+        // The YUV kernels only have an SSSE3 version. yuv reads VU pairs, yuvR reads UV pairs
+        // and yuv2 reads separate U and V planes.
+        void (*yuv)(void *dst, const unsigned char *pY, const unsigned char *pUV, uint32_t count8,
+                    const short *param);
+        void (*yuvR)(void *dst, const unsigned char *pY, const unsigned char *pUV, uint32_t count8,
+                     const short *param);
+        void (*yuv2)(void *dst, const unsigned char *pY, const unsigned char *pU,
+                     const unsigned char *pV, uint32_t count8, const short *param);
+
+        // The 3D LUT kernel only has an SSSE3 version: each pixel reads its own cell of the cube,
+        // so wider vectors would only add gathers. count is in pixels.
+        void (*lut3d)(void *dst, const void *src, const uint8_t *cube, const uint32_t *offsets,
+                      const uint32_t *weights, size_t strideY, size_t strideZ, uint32_t count);
+    };
+
+    const X86Kernels *x86Ssse3Kernels();
+
+    const X86Kernels *x86Avx2Kernels();
+
+    const X86Kernels *x86Avx512Kernels();
+
+/**
+ * Returns the table of the widest kernels the CPU and the OS support.
+ */
+    const X86Kernels *selectX86Kernels();
+
+}  // namespace renderscript
+
+#endif  // ANDROID_RENDERSCRIPT_TOOLKIT_X86_KERNELS_H
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+
+#include "RenderScriptToolkit.h"
+#include "TaskProcessor.h"
+#include "Utils.h"
+
+namespace renderscript {
+
+#define LOG_TAG "renderscript.toolkit.YuvToRgb"
+
+    using YuvPlanes = RenderScriptToolkit::YuvPlanes;
+
+    inline size_t roundUpTo16(size_t val) {
+        return (val + 15u) & ~15u;
+    }
+
+/**
+ * Converts a YUV image with chroma subsampled by two in both directions to RGBA.
+ *
+ * NV21, YV12 and YUV_420_888 only differ by where the planes start, their row strides and the
+ * distance between two chroma samples of a row, so they are all described by YuvPlanes.
+ */
+    class YuvToRgbTask : public Task {
+        YuvPlanes mPlanes;
+        uchar4 *mOut;
+
+        // Process a 2D tile of the overall work. threadIndex identifies which thread does the work.
+        void processData(int threadIndex, size_t startX, size_t startY, size_t endX,
+                         size_t endY) override;
+
+    public:
+        const char *name() const override { return "YuvToRgb"; }
+
+        YuvToRgbTask(const YuvPlanes &planes, uint8_t *output, size_t sizeX, size_t sizeY)
+                : Task{sizeX, sizeY, 4, false, nullptr},
+                  mPlanes{planes},
+                  mOut{reinterpret_cast<uchar4 *>(output)} {}
+    };
+
+    // Coefficients of the x86 kernels: the BT.601 video range conversion in 8.8 fixed point.
+    static const short YuvCoeff[] = {
+            298, 409, -100, 516, -208, 255, 0, 0,
+            16, 16, 16, 16, 16, 16, 16, 16,
+            128, 128, 128, 128, 128, 128, 128, 128,
+            298, 298, 298, 298, 298, 298, 298, 298,
+            255, 255, 255, 255, 255, 255, 255, 255
+    };
+
+    // Same arithmetic as the kernels.
+    static uchar4 rsYuvToRGBA_uchar4(uchar y, uchar u, uchar v) {
+        int Y = static_cast<int>(y) - 16;
+        int U = static_cast<int>(u) - 128;
+        int V = static_cast<int>(v) - 128;
+
+        int4 p;
+        p.x = (Y * 298 + V * 409 + 128) >> 8;
+        p.y = (Y * 298 - U * 100 - V * 208 + 128) >> 8;
+        p.z = (Y * 298 + U * 516 + 128) >> 8;
+        p.w = 255;
+        return convert<uchar4>(clamp(p, 0, 255));
+    }
+
+    void YuvToRgbTask::processData(int /* threadIndex */, size_t startX, size_t startY,
+                                   size_t endX, size_t endY) {
+        const size_t cstep = mPlanes.uvPixelStride;
+        for (size_t y = startY; y < endY; y++) {
+            const uchar *Y = mPlanes.y + y * mPlanes.yRowStride;
+            const uchar *uin = mPlanes.u + (y >> 1) * mPlanes.uvRowStride;
+            const uchar *vin = mPlanes.v + (y >> 1) * mPlanes.uvRowStride;
+            uchar4 *out = mOut + y * mSizeX;
+            size_t x1 = startX;
+            size_t x2 = endX;
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+            // The kernels start on a pair of pixels that shares its chroma.
+            if (mUsesSimd && (x1 & 1) != 0 && x1 < x2) {
+                out[x1] = rsYuvToRGBA_uchar4(Y[x1], uin[(x1 >> 1) * cstep],
+                                             vin[(x1 >> 1) * cstep]);
+                x1++;
+            }
+            uint32_t len = static_cast<uint32_t>((x2 - x1) >> 3);
+            if (mUsesSimd && x1 < x2 && len > 0) {
+                const uchar *u = uin + (x1 >> 1) * cstep;
+                const uchar *v = vin + (x1 >> 1) * cstep;
+                bool converted = true;
+                if (cstep == 1) {
+                    mX86Kernels->yuv2(out + x1, Y + x1, u, v, len, YuvCoeff);
+                } else if (cstep == 2 && u == v + 1) {
+                    mX86Kernels->yuv(out + x1, Y + x1, v, len, YuvCoeff);
+                } else if (cstep == 2 && u + 1 == v) {
+                    mX86Kernels->yuvR(out + x1, Y + x1, u, len, YuvCoeff);
+                } else {
+                    converted = false;
+                }
+                if (converted) {
+                    x1 += static_cast<size_t>(len) << 3;
+                }
+            }
+#endif
+
+            for (; x1 < x2; x1++) {
+                out[x1] = rsYuvToRGBA_uchar4(Y[x1], uin[(x1 >> 1) * cstep],
+                                             vin[(x1 >> 1) * cstep]);
+            }
+        }
+    }
+
+    void RenderScriptToolkit::yuvToRgb(const uint8_t *input, uint8_t *output, size_t sizeX,
+                                       size_t sizeY, YuvFormat format) {
+        YuvPlanes planes;
+        planes.y = input;
+        switch (format) {
+            case YuvFormat::NV21:
+                // A full size Y plane followed by interleaved V and U samples.
+                planes.yRowStride = sizeX;
+                planes.uvRowStride = sizeX;
+                planes.uvPixelStride = 2;
+                planes.v = input + sizeX * sizeY;
+                planes.u = planes.v + 1;
+                break;
+            case YuvFormat::YV12:
+                // The Y plane followed by the V and U planes, all with rows padded to 16 bytes.
+                planes.yRowStride = roundUpTo16(sizeX);
+                planes.uvRowStride = roundUpTo16(planes.yRowStride >> 1u);
+                planes.uvPixelStride = 1;
+                planes.v = input + planes.yRowStride * sizeY;
+                planes.u = planes.v + planes.uvRowStride * (sizeY >> 1u);
+                break;
+            default:
+                ALOGE("Unknown YuvFormat %d", static_cast<int>(format));
+                return;
+        }
+        yuvToRgb(planes, output, sizeX, sizeY);
+    }
+
+    void RenderScriptToolkit::yuvToRgb(const YuvPlanes &planes, uint8_t *output, size_t sizeX,
+                                       size_t sizeY) {
+#ifdef ANDROID_RENDERSCRIPT_TOOLKIT_VALIDATE
+        if (planes.uvPixelStride != 1 && planes.uvPixelStride != 2) {
+            ALOGE("The uvPixelStride should be 1 or 2. %zu provided.", planes.uvPixelStride);
+            return;
+        }
+        if (planes.yRowStride < sizeX) {
+            ALOGE("The yRowStride %zu is smaller than the width %zu.", planes.yRowStride, sizeX);
+            return;
+        }
+#endif
+
+        YuvToRgbTask task(planes, output, sizeX, sizeY);
+        processor->doTask(&task);
+    }
+
+    void RenderScriptToolkit::yuvToRgbAndBlur(const YuvPlanes &planes, uint8_t *output,
+                                              size_t sizeX, size_t sizeY, int radius) {
+        // The whole image is converted first: each blurred row needs the rows around it.
+        std::lock_guard<std::mutex> lock(yuvIntermediateMutex);
+        yuvIntermediate.resize(sizeX * sizeY * 4);
+        yuvToRgb(planes, yuvIntermediate.data(), sizeX, sizeY);
+        blur(yuvIntermediate.data(), output, sizeX, sizeY, 4, radius);
+    }
+
+}  // namespace renderscript
@@ -17,6 +17,8 @@
 #include <stdint.h>
 #include <x86intrin.h>
 
+#include "X86Kernels.h"
+
 namespace renderscript {
 
 /* Unsigned extend packed 8-bit integer (in LBS) into packed 32-bit integer */
@@ -165,7 +167,7 @@ namespace renderscript {
         c2 = _mm_unpacklo_epi16(c2, c3);
 
         for (i = 0; i < count; ++i) {
-            i4 = _mm_load_si128((const __m128i *) src);
+            i4 = _mm_loadu_si128((const __m128i *) src);
             xy = _mm_shuffle_epi8(i4, Mxy);
             zw = _mm_shuffle_epi8(i4, Mzw);
 
@@ -396,11 +398,14 @@ namespace renderscript {
                 g0 = _mm_shuffle_ps(gx, gx, _MM_SHUFFLE(0, 0, 0, 0));
                 pf = _mm_add_ps(pf, _mm_mul_ps(g0, p0));
                 g1 = _mm_shuffle_ps(gx, gx, _MM_SHUFFLE(1, 1, 1, 1));
-                pf = _mm_add_ps(pf, _mm_mul_ps(g1, _mm_alignr_epi8(p1, p0, 4)));
+                pf = _mm_add_ps(pf, _mm_mul_ps(g1, _mm_castsi128_ps(_mm_alignr_epi8(
+                        _mm_castps_si128(p1), _mm_castps_si128(p0), 4))));
                 g2 = _mm_shuffle_ps(gx, gx, _MM_SHUFFLE(2, 2, 2, 2));
-                pf = _mm_add_ps(pf, _mm_mul_ps(g2, _mm_alignr_epi8(p1, p0, 8)));
+                pf = _mm_add_ps(pf, _mm_mul_ps(g2, _mm_castsi128_ps(_mm_alignr_epi8(
+                        _mm_castps_si128(p1), _mm_castps_si128(p0), 8))));
                 g3 = _mm_shuffle_ps(gx, gx, _MM_SHUFFLE(3, 3, 3, 3));
-                pf = _mm_add_ps(pf, _mm_mul_ps(g3, _mm_alignr_epi8(p1, p0, 12)));
+                pf = _mm_add_ps(pf, _mm_mul_ps(g3, _mm_castsi128_ps(_mm_alignr_epi8(
+                        _mm_castps_si128(p1), _mm_castps_si128(p0), 12))));
             }
 
             o = _mm_cvtps_epi32(pf);
@@ -409,6 +414,86 @@ namespace renderscript {
         }
     }
 
+/*
+ * Integer kernels of the separable blur. They round like rsdIntrinsicBlurU4_K: the vertical pass
+ * keeps 7 fractional bits, the horizontal one narrows to 8.7 and then to an integer.
+ *
+ * Taps are summed two at a time with pmaddwd, interleaving the values of two taps and pairing
+ * their weights in each 32-bit lane. pmaddwd multiplies signed words, which is exact here: the
+ * weights of a radius of 1 or more stay below 2^15, and so do the 8.7 values. Each sum stays
+ * below 2^31 since the weights add up to about 65536.
+ */
+
+    static inline __m128i blurWeightPair(const uint16_t *ip, int r, int rct) {
+        const uint32_t second = r + 1 < rct ? ip[r + 1] : 0;
+        return _mm_set1_epi32((int) (ip[r] | (second << 16)));
+    }
+
+    void rsdIntrinsicBlurVU_K(uint16_t *dst, const uint8_t *const *rows, const uint16_t *ip,
+                              int rct, size_t count) {
+        const __m128i C0 = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi32(1 << 8);
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            __m128i lo = round;
+            __m128i hi = round;
+            for (int r = 0; r < rct; r += 2) {
+                const __m128i w = blurWeightPair(ip, r, rct);
+                const __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (rows[r] + i)), C0);
+                const __m128i b = r + 1 < rct
+                        ? _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (rows[r + 1] + i)), C0)
+                        : C0;
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+            }
+            _mm_storeu_si128((__m128i *) (dst + i),
+                             _mm_packs_epi32(_mm_srli_epi32(lo, 9), _mm_srli_epi32(hi, 9)));
+        }
+
+        for (; i < count; i++) {
+            uint32_t sum = 1 << 8;
+            for (int r = 0; r < rct; r++) {
+                sum += rows[r][i] * (uint32_t) ip[r];
+            }
+            dst[i] = (uint16_t) (sum >> 9);
+        }
+    }
+
+    void rsdIntrinsicBlurHU_K(uint8_t *dst, const uint16_t *src, size_t step,
+                              const uint16_t *ip, int rct, size_t count) {
+        const __m128i C0 = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi32(1 << 15);
+        const __m128i round16 = _mm_set1_epi16(1 << 6);
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            __m128i lo = round;
+            __m128i hi = round;
+            for (int r = 0; r < rct; r += 2) {
+                const __m128i w = blurWeightPair(ip, r, rct);
+                const __m128i a = _mm_loadu_si128((const __m128i *) (src + i + r * step));
+                const __m128i b = r + 1 < rct
+                        ? _mm_loadu_si128((const __m128i *) (src + i + (r + 1) * step))
+                        : C0;
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+            }
+            __m128i v = _mm_packs_epi32(_mm_srli_epi32(lo, 16), _mm_srli_epi32(hi, 16));
+            v = _mm_srli_epi16(_mm_add_epi16(v, round16), 7);
+            _mm_storel_epi64((__m128i *) (dst + i), _mm_packus_epi16(v, v));
+        }
+
+        for (; i < count; i++) {
+            uint32_t sum = 1 << 15;
+            for (int r = 0; r < rct; r++) {
+                sum += src[i + r * step] * (uint32_t) ip[r];
+            }
+            const uint32_t v = ((sum >> 16) + (1 << 6)) >> 7;
+            dst[i] = (uint8_t) (v > 255 ? 255 : v);
+        }
+    }
+
     void rsdIntrinsicYuv_K(void *dst,
                            const unsigned char *pY, const unsigned char *pUV,
                            uint32_t count, const short *param) {
@@ -554,9 +639,12 @@ namespace renderscript {
         uint32_t i;
 
         for (i = 0; i < (count << 1); ++i) {
+            // Each U and V sample covers two pixels.
             Y = cvtepu8_epi32(_mm_set1_epi32(*(const int *) pY));
-            U = cvtepu8_epi32(_mm_set1_epi32(*(const int *) pU));
-            V = cvtepu8_epi32(_mm_set1_epi32(*(const int *) pV));
+            U = cvtepu8_epi32(_mm_cvtsi32_si128(*(const uint16_t *) pU));
+            V = cvtepu8_epi32(_mm_cvtsi32_si128(*(const uint16_t *) pV));
+            U = _mm_shuffle_epi32(U, 0x50);
+            V = _mm_shuffle_epi32(V, 0x50);
 
             Y = _mm_sub_epi32(Y, biasY);
             U = _mm_sub_epi32(U, biasUV);
@@ -589,12 +677,67 @@ namespace renderscript {
             y4 = _mm_shuffle_epi8(y3, T4x4);
             _mm_storeu_si128((__m128i *) dst, y4);
             pY += 4;
-            pU += 4;
-            pV += 4;
+            pU += 2;
+            pV += 2;
             dst = (__m128i *) dst + 1;
         }
     }
 
+    /*
+     * One pixel per iteration. offsets and weights each hold 3 tables of 256 entries, indexed by
+     * the red, green and blue of the pixel. The offset of each channel is added to find the first
+     * corner of the cell; the weights are the 7-bit (128 - f, f) pairs of madd_epi16.
+     */
+    void rsdIntrinsicLut3d_K(void *dst, const void *src, const uint8_t *cube,
+                             const uint32_t *offsets, const uint32_t *weights,
+                             size_t strideY, size_t strideZ, uint32_t count) {
+        const __m128i Mlo = _mm_set_epi8(-1, 7, -1, 3, -1, 6, -1, 2,
+                                         -1, 5, -1, 1, -1, 4, -1, 0);
+        const __m128i Mhi = _mm_set_epi8(-1, 15, -1, 11, -1, 14, -1, 10,
+                                         -1, 13, -1, 9, -1, 12, -1, 8);
+        const __m128i round = _mm_set1_epi32(1 << 13);
+        const uint32_t *in = (const uint32_t *) src;
+        uint32_t *out = (uint32_t *) dst;
+        uint32_t i;
+
+        for (i = 0; i < count; ++i) {
+            const uint32_t p = in[i];
+            const uint32_t r = p & 0xff;
+            const uint32_t g = (p >> 8) & 0xff;
+            const uint32_t b = (p >> 16) & 0xff;
+            const uint8_t *c = cube + offsets[r] + offsets[256 + g] + offsets[512 + b];
+
+            /* The two corners along x are next to each other in the cube. */
+            __m128i z0 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *) c),
+                                            _mm_loadl_epi64((const __m128i *) (c + strideY)));
+            __m128i z1 = _mm_unpacklo_epi64(
+                    _mm_loadl_epi64((const __m128i *) (c + strideZ)),
+                    _mm_loadl_epi64((const __m128i *) (c + strideY + strideZ)));
+
+            const __m128i wx = _mm_set1_epi32((int) weights[r]);
+            const __m128i x00 = _mm_madd_epi16(_mm_shuffle_epi8(z0, Mlo), wx);
+            const __m128i x10 = _mm_madd_epi16(_mm_shuffle_epi8(z0, Mhi), wx);
+            const __m128i x01 = _mm_madd_epi16(_mm_shuffle_epi8(z1, Mlo), wx);
+            const __m128i x11 = _mm_madd_epi16(_mm_shuffle_epi8(z1, Mhi), wx);
+
+            const __m128i wy = _mm_set1_epi32((int) weights[256 + g]);
+            const __m128i y0 = _mm_packs_epi32(x00, x01);
+            const __m128i y1 = _mm_packs_epi32(x10, x11);
+            z0 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(y0, y1), wy), 7);
+            z1 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(y0, y1), wy), 7);
+
+            const __m128i wz = _mm_set1_epi32((int) weights[512 + b]);
+            __m128i v = _mm_madd_epi16(_mm_unpacklo_epi16(_mm_packs_epi32(z0, z0),
+                                                          _mm_packs_epi32(z1, z1)), wz);
+            v = _mm_srai_epi32(_mm_add_epi32(v, round), 14);
+            v = _mm_packs_epi32(v, v);
+            v = _mm_packus_epi16(v, v);
+
+            /* The alpha of the input is kept. */
+            out[i] = ((uint32_t) _mm_cvtsi128_si32(v) & 0x00ffffff) | (p & 0xff000000);
+        }
+    }
+
     extern "C" void rsdIntrinsicConvolve5x5_K(void *dst, const void *y0,
                                               const void *y1, const void *y2,
                                               const void *y3, const void *y4,
@@ -1318,4 +1461,43 @@ namespace renderscript {
         }
     }
 
+    const X86Kernels *x86Ssse3Kernels() {
+        static const X86Kernels kernels = {
+                rsdIntrinsicBlurVU_K,
+                rsdIntrinsicBlurHU_K,
+                rsdIntrinsicColorMatrix4x4_K,
+                rsdIntrinsicColorMatrix3x3_K,
+                rsdIntrinsicColorMatrixDot_K,
+                rsdIntrinsicBlendSrcOver_K,
+                rsdIntrinsicBlendDstOver_K,
+                rsdIntrinsicBlendSrcIn_K,
+                rsdIntrinsicBlendDstIn_K,
+                rsdIntrinsicBlendSrcOut_K,
+                rsdIntrinsicBlendDstOut_K,
+                rsdIntrinsicBlendSrcAtop_K,
+                rsdIntrinsicBlendDstAtop_K,
+                rsdIntrinsicBlendXor_K,
+                rsdIntrinsicBlendMultiply_K,
+                rsdIntrinsicBlendAdd_K,
+                rsdIntrinsicBlendSub_K,
+                rsdIntrinsicYuv_K,
+                rsdIntrinsicYuvR_K,
+                rsdIntrinsicYuv2_K,
+                rsdIntrinsicLut3d_K,
+        };
+        return &kernels;
+    }
+
+    const X86Kernels *selectX86Kernels() {
+        /* __builtin_cpu_supports also checks that the OS saves the wider registers. */
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+            return x86Avx512Kernels();
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return x86Avx2Kernels();
+        }
+        return x86Ssse3Kernels();
+    }
+
 }  // namespace renderscript
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Compiled with -mavx512f -mavx512bw. See x86_wide.h. */
+
+#include "x86_wide.h"
+
+namespace renderscript {
+namespace {
+
+    struct Avx512Ops {
+        using V = __m512i;
+
+        static V zero() { return _mm512_setzero_si512(); }
+        static V set1_epi16(short x) { return _mm512_set1_epi16(x); }
+        static V set1_epi32(int x) { return _mm512_set1_epi32(x); }
+        static V broadcast128(__m128i x) { return _mm512_broadcast_i32x4(x); }
+
+        static V load(const void *p) { return _mm512_loadu_si512(p); }
+        static void store(void *p, V x) { _mm512_storeu_si512(p, x); }
+        static V loadWidenU8(const uint8_t *p) {
+            return _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) p));
+        }
+        static void storeNarrowU16(uint8_t *p, V x) {
+            _mm256_storeu_si256((__m256i *) p, _mm512_cvtusepi16_epi8(x));
+        }
+
+        static V unpacklo_epi8(V a, V b) { return _mm512_unpacklo_epi8(a, b); }
+        static V unpackhi_epi8(V a, V b) { return _mm512_unpackhi_epi8(a, b); }
+        static V unpacklo_epi16(V a, V b) { return _mm512_unpacklo_epi16(a, b); }
+        static V unpackhi_epi16(V a, V b) { return _mm512_unpackhi_epi16(a, b); }
+        static V packs_epi32(V a, V b) { return _mm512_packs_epi32(a, b); }
+        static V packus_epi32(V a, V b) { return _mm512_packus_epi32(a, b); }
+        static V packus_epi16(V a, V b) { return _mm512_packus_epi16(a, b); }
+        static V shuffle_epi8(V a, V m) { return _mm512_shuffle_epi8(a, m); }
+
+        static V add_epi16(V a, V b) { return _mm512_add_epi16(a, b); }
+        static V sub_epi16(V a, V b) { return _mm512_sub_epi16(a, b); }
+        static V add_epi32(V a, V b) { return _mm512_add_epi32(a, b); }
+        static V adds_epu8(V a, V b) { return _mm512_adds_epu8(a, b); }
+        static V subs_epu8(V a, V b) { return _mm512_subs_epu8(a, b); }
+        static V adds_epu16(V a, V b) { return _mm512_adds_epu16(a, b); }
+        static V mullo_epi16(V a, V b) { return _mm512_mullo_epi16(a, b); }
+        static V madd_epi16(V a, V b) { return _mm512_madd_epi16(a, b); }
+        static V srli_epi16(V a, int n) { return _mm512_srli_epi16(a, n); }
+        static V srli_epi32(V a, int n) { return _mm512_srli_epi32(a, n); }
+        static V srai_epi32(V a, int n) { return _mm512_srai_epi32(a, n); }
+
+        static V and_si(V a, V b) { return _mm512_and_si512(a, b); }
+        static V andnot_si(V a, V b) { return _mm512_andnot_si512(a, b); }
+        static V or_si(V a, V b) { return _mm512_or_si512(a, b); }
+        static V xor_si(V a, V b) { return _mm512_xor_si512(a, b); }
+    };
+
+}  // namespace
+
+    const X86Kernels *x86Avx512Kernels() {
+        return WideKernels<Avx512Ops>::table();
+    }
+
+}  // namespace renderscript
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RENDERSCRIPT_TOOLKIT_X86_WIDE_H
+#define ANDROID_RENDERSCRIPT_TOOLKIT_X86_WIDE_H
+
+#include <stdint.h>
+#include <x86intrin.h>
+
+#include "X86Kernels.h"
+
+/*
+ * The kernels of X86Kernels written once for any vector width. Only x86_avx2.cpp and
+ * x86_avx512.cpp include this file, each with an Ops class wrapping the intrinsics of its width.
+ *
+ * Like the SSSE3 kernels in x86.cpp, every operation works within 128-bit lanes, so that a wide
+ * vector behaves as several SSSE3 vectors side by side and the results are the same. Everything is
+ * in an anonymous namespace: these translation units are compiled for a wider instruction set, and
+ * none of their code may be shared with the rest of the library.
+ */
+
+namespace renderscript {
+namespace {
+
+    template<typename Ops>
+    class WideKernels {
+        using V = typename Ops::V;
+        static constexpr size_t kBytes = sizeof(V);
+
+        static V weightPair(const uint16_t *ip, int r, int rct) {
+            const uint32_t second = r + 1 < rct ? ip[r + 1] : 0;
+            return Ops::set1_epi32((int) (ip[r] | (second << 16)));
+        }
+
+        /* Broadcasts the alpha of each pixel to its four 16-bit channels. */
+        static V alpha16(V x) {
+            const V M = Ops::broadcast128(_mm_set_epi8(15, 14, 15, 14, 15, 14, 15, 14,
+                                                       7, 6, 7, 6, 7, 6, 7, 6));
+            return Ops::shuffle_epi8(x, M);
+        }
+
+        /* Widens the channels of the pixels to 16 bits, applies f, and narrows them back. */
+        template<typename F>
+        static V perChannel(V in, V out, F f) {
+            const V C0 = Ops::zero();
+            return Ops::packus_epi16(f(Ops::unpacklo_epi8(in, C0), Ops::unpacklo_epi8(out, C0)),
+                                     f(Ops::unpackhi_epi8(in, C0), Ops::unpackhi_epi8(out, C0)));
+        }
+
+        /* Returns result with the alpha bytes of keep. */
+        static V withAlphaOf(V result, V keep) {
+            const V M0001 = Ops::set1_epi32((int) 0xff000000);
+            return Ops::or_si(Ops::andnot_si(M0001, result), Ops::and_si(M0001, keep));
+        }
+
+        template<typename F>
+        static void blend(void *dst, const void *src, uint32_t count8,
+                          void (*tail)(void *, const void *, uint32_t), F f) {
+            const uint32_t blocksPerVector = kBytes / 32;
+            const uint32_t wideCount8 = count8 - count8 % blocksPerVector;
+            for (uint32_t i = 0; i < wideCount8; i += blocksPerVector) {
+                Ops::store(dst, f(Ops::load(src), Ops::load(dst)));
+                src = (const char *) src + kBytes;
+                dst = (char *) dst + kBytes;
+            }
+            if (wideCount8 < count8) {
+                tail(dst, src, count8 - wideCount8);
+            }
+        }
+
+        enum class MatrixShape { k4x4, k3x3, kDot };
+
+        template<MatrixShape shape>
+        static void colorMatrix(void *dst, const void *src, const short *coef, uint32_t count,
+                                void (*tail)(void *, const void *, const short *, uint32_t)) {
+            const V T4x4 = Ops::broadcast128(_mm_set_epi8(15, 11, 7, 3,
+                                                          14, 10, 6, 2,
+                                                          13, 9, 5, 1,
+                                                          12, 8, 4, 0));
+            const V Mxy = Ops::broadcast128(
+                    _mm_set_epi32(0xff0dff0c, 0xff09ff08, 0xff05ff04, 0xff01ff00));
+            const V Mzw = Ops::broadcast128(
+                    _mm_set_epi32(0xff0fff0e, 0xff0bff0a, 0xff07ff06, 0xff03ff02));
+
+            __m128i c0, c2;
+            if (shape == MatrixShape::kDot) {
+                c0 = _mm_unpacklo_epi16(
+                        _mm_shufflelo_epi16(_mm_loadl_epi64((const __m128i *) (coef + 0)), 0),
+                        _mm_shufflelo_epi16(_mm_loadl_epi64((const __m128i *) (coef + 4)), 0));
+                c2 = _mm_unpacklo_epi16(
+                        _mm_shufflelo_epi16(_mm_loadl_epi64((const __m128i *) (coef + 8)), 0),
+                        _mm_shufflelo_epi16(_mm_loadl_epi64((const __m128i *) (coef + 12)), 0));
+            } else {
+                c0 = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) (coef + 0)),
+                                        _mm_loadl_epi64((const __m128i *) (coef + 4)));
+                c2 = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) (coef + 8)),
+                                        _mm_loadl_epi64((const __m128i *) (coef + 12)));
+            }
+            const V cx0 = Ops::broadcast128(_mm_shuffle_epi32(c0, 0x00));
+            const V cy0 = Ops::broadcast128(_mm_shuffle_epi32(c0, 0x55));
+            const V cz0 = Ops::broadcast128(_mm_shuffle_epi32(c0, 0xaa));
+            const V cw0 = Ops::broadcast128(_mm_shuffle_epi32(c0, 0xff));
+            const V cx2 = Ops::broadcast128(_mm_shuffle_epi32(c2, 0x00));
+            const V cy2 = Ops::broadcast128(_mm_shuffle_epi32(c2, 0x55));
+            const V cz2 = Ops::broadcast128(_mm_shuffle_epi32(c2, 0xaa));
+            const V cw2 = Ops::broadcast128(_mm_shuffle_epi32(c2, 0xff));
+            const V dot0 = Ops::broadcast128(c0);
+            const V dot2 = Ops::broadcast128(c2);
+
+            const uint32_t blocksPerVector = kBytes / 16;
+            const uint32_t wideCount = count - count % blocksPerVector;
+            for (uint32_t i = 0; i < wideCount; i += blocksPerVector) {
+                const V i4 = Ops::load(src);
+                const V xy = Ops::shuffle_epi8(i4, Mxy);
+                const V zw = Ops::shuffle_epi8(i4, Mzw);
+                V x2, y2, z2, w2;
+
+                if (shape == MatrixShape::kDot) {
+                    x2 = Ops::add_epi32(Ops::madd_epi16(xy, dot0), Ops::madd_epi16(zw, dot2));
+                    x2 = Ops::srai_epi32(x2, 8);
+                    y2 = x2;
+                    z2 = x2;
+                } else {
+                    x2 = Ops::add_epi32(Ops::madd_epi16(xy, cx0), Ops::madd_epi16(zw, cx2));
+                    y2 = Ops::add_epi32(Ops::madd_epi16(xy, cy0), Ops::madd_epi16(zw, cy2));
+                    z2 = Ops::add_epi32(Ops::madd_epi16(xy, cz0), Ops::madd_epi16(zw, cz2));
+                    x2 = Ops::srai_epi32(x2, 8);
+                    y2 = Ops::srai_epi32(y2, 8);
+                    z2 = Ops::srai_epi32(z2, 8);
+                }
+                if (shape == MatrixShape::k4x4) {
+                    w2 = Ops::add_epi32(Ops::madd_epi16(xy, cw0), Ops::madd_epi16(zw, cw2));
+                    w2 = Ops::srai_epi32(w2, 8);
+                } else {
+                    w2 = Ops::srli_epi32(zw, 16);
+                }
+
+                const V o4 = Ops::packus_epi16(Ops::packus_epi32(x2, y2), Ops::packus_epi32(z2, w2));
+                Ops::store(dst, Ops::shuffle_epi8(o4, T4x4));
+
+                src = (const char *) src + kBytes;
+                dst = (char *) dst + kBytes;
+            }
+            if (wideCount < count) {
+                tail(dst, src, coef, count - wideCount);
+            }
+        }
+
+    public:
+        static void blurVU(uint16_t *dst, const uint8_t *const *rows, const uint16_t *ip, int rct,
+                           size_t count) {
+            const size_t step = kBytes / 2;
+            const size_t wideCount = count - count % step;
+            for (size_t i = 0; i < wideCount; i += step) {
+                V lo = Ops::set1_epi32(1 << 8);
+                V hi = lo;
+                for (int r = 0; r < rct; r += 2) {
+                    const V w = weightPair(ip, r, rct);
+                    const V a = Ops::loadWidenU8(rows[r] + i);
+                    const V b = r + 1 < rct ? Ops::loadWidenU8(rows[r + 1] + i) : Ops::zero();
+                    lo = Ops::add_epi32(lo, Ops::madd_epi16(Ops::unpacklo_epi16(a, b), w));
+                    hi = Ops::add_epi32(hi, Ops::madd_epi16(Ops::unpackhi_epi16(a, b), w));
+                }
+                /* The lane-wise unpacks and pack cancel out, the words come back in order. */
+                Ops::store(dst + i, Ops::packs_epi32(Ops::srli_epi32(lo, 9), Ops::srli_epi32(hi, 9)));
+            }
+            if (wideCount < count) {
+                const uint8_t *tailRows[X86Kernels::kMaxBlurTaps];
+                for (int r = 0; r < rct; r++) {
+                    tailRows[r] = rows[r] + wideCount;
+                }
+                x86Ssse3Kernels()->blurVU(dst + wideCount, tailRows, ip, rct, count - wideCount);
+            }
+        }
+
+        static void blurHU(uint8_t *dst, const uint16_t *src, size_t step, const uint16_t *ip,
+                           int rct, size_t count) {
+            const size_t cells = kBytes / 2;
+            const size_t wideCount = count - count % cells;
+            for (size_t i = 0; i < wideCount; i += cells) {
+                V lo = Ops::set1_epi32(1 << 15);
+                V hi = lo;
+                for (int r = 0; r < rct; r += 2) {
+                    const V w = weightPair(ip, r, rct);
+                    const V a = Ops::load(src + i + r * step);
+                    const V b = r + 1 < rct ? Ops::load(src + i + (r + 1) * step) : Ops::zero();
+                    lo = Ops::add_epi32(lo, Ops::madd_epi16(Ops::unpacklo_epi16(a, b), w));
+                    hi = Ops::add_epi32(hi, Ops::madd_epi16(Ops::unpackhi_epi16(a, b), w));
+                }
+                V v = Ops::packs_epi32(Ops::srli_epi32(lo, 16), Ops::srli_epi32(hi, 16));
+                v = Ops::srli_epi16(Ops::add_epi16(v, Ops::set1_epi16(1 << 6)), 7);
+                Ops::storeNarrowU16(dst + i, v);
+            }
+            if (wideCount < count) {
+                x86Ssse3Kernels()->blurHU(dst + wideCount, src + wideCount, step, ip, rct,
+                                          count - wideCount);
+            }
+        }
+
+        static void colorMatrix4x4(void *dst, const void *src, const short *coef, uint32_t count) {
+            colorMatrix<MatrixShape::k4x4>(dst, src, coef, count, x86Ssse3Kernels()->colorMatrix4x4);
+        }
+
+        static void colorMatrix3x3(void *dst, const void *src, const short *coef, uint32_t count) {
+            colorMatrix<MatrixShape::k3x3>(dst, src, coef, count, x86Ssse3Kernels()->colorMatrix3x3);
+        }
+
+        static void colorMatrixDot(void *dst, const void *src, const short *coef, uint32_t count) {
+            colorMatrix<MatrixShape::kDot>(dst, src, coef, count, x86Ssse3Kernels()->colorMatrixDot);
+        }
+
+        static void blendSrcOver(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendSrcOver, [](V in, V out) {
+                return perChannel(in, out, [](V ins, V outs) {
+                    const V t = Ops::mullo_epi16(outs, Ops::sub_epi16(Ops::set1_epi16(255), alpha16(ins)));
+                    return Ops::add_epi16(Ops::srli_epi16(t, 8), ins);
+                });
+            });
+        }
+
+        static void blendDstOver(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendDstOver, [](V in, V out) {
+                return perChannel(in, out, [](V ins, V outs) {
+                    const V t = Ops::mullo_epi16(ins, Ops::sub_epi16(Ops::set1_epi16(255), alpha16(outs)));
+                    return Ops::add_epi16(Ops::srli_epi16(t, 8), outs);
+                });
+            });
+        }
+
+        static void blendSrcIn(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendSrcIn, [](V in, V out) {
+                return perChannel(in, out, [](V ins, V outs) {
+                    return Ops::srli_epi16(Ops::mullo_epi16(ins, alpha16(outs)), 8);
+                });
+            });
+        }
+
+        static void blendDstIn(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendDstIn, [](V in, V out) {
+                return perChannel(in, out, [](V ins, V outs) {
+                    return Ops::srli_epi16(Ops::mullo_epi16(outs, alpha16(ins)), 8);
+                });
+            });
+        }
+
+        static void blendSrcOut(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendSrcOut, [](V in, V out) {
+                return perChannel(in, out, [](V ins, V outs) {
+                    const V t = Ops::mullo_epi16(ins, Ops::sub_epi16(Ops::set1_epi16(255), alpha16(outs)));
+                    return Ops::srli_epi16(t, 8);
+                });
+            });
+        }
+
+        static void blendDstOut(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendDstOut, [](V in, V out) {
+                return perChannel(in, out, [](V ins, V outs) {
+                    const V t = Ops::mullo_epi16(outs, Ops::sub_epi16(Ops::set1_epi16(255), alpha16(ins)));
+                    return Ops::srli_epi16(t, 8);
+                });
+            });
+        }
+
+        static void blendSrcAtop(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendSrcAtop, [](V in, V out) {
+                const V t = perChannel(in, out, [](V ins, V outs) {
+                    const V sum = Ops::mullo_epi16(Ops::sub_epi16(Ops::set1_epi16(255), alpha16(ins)), outs);
+                    return Ops::srli_epi16(Ops::adds_epu16(sum, Ops::mullo_epi16(alpha16(outs), ins)), 8);
+                });
+                return withAlphaOf(t, out);
+            });
+        }
+
+        static void blendDstAtop(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendDstAtop, [](V in, V out) {
+                const V t = perChannel(in, out, [](V ins, V outs) {
+                    const V sum = Ops::mullo_epi16(Ops::sub_epi16(Ops::set1_epi16(255), alpha16(outs)), ins);
+                    return Ops::srli_epi16(Ops::adds_epu16(sum, Ops::mullo_epi16(alpha16(ins), outs)), 8);
+                });
+                return withAlphaOf(t, in);
+            });
+        }
+
+        static void blendXor(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendXor,
+                  [](V in, V out) { return Ops::xor_si(out, in); });
+        }
+
+        static void blendMultiply(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendMultiply, [](V in, V out) {
+                return perChannel(in, out, [](V ins, V outs) {
+                    return Ops::srli_epi16(Ops::mullo_epi16(ins, outs), 8);
+                });
+            });
+        }
+
+        static void blendAdd(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendAdd,
+                  [](V in, V out) { return Ops::adds_epu8(out, in); });
+        }
+
+        static void blendSub(void *dst, const void *src, uint32_t count8) {
+            blend(dst, src, count8, x86Ssse3Kernels()->blendSub,
+                  [](V in, V out) { return Ops::subs_epu8(out, in); });
+        }
+
+        static const X86Kernels *table() {
+            static const X86Kernels kernels = {
+                    blurVU,
+                    blurHU,
+                    colorMatrix4x4,
+                    colorMatrix3x3,
+                    colorMatrixDot,
+                    blendSrcOver,
+                    blendDstOver,
+                    blendSrcIn,
+                    blendDstIn,
+                    blendSrcOut,
+                    blendDstOut,
+                    blendSrcAtop,
+                    blendDstAtop,
+                    blendXor,
+                    blendMultiply,
+                    blendAdd,
+                    blendSub,
+                    x86Ssse3Kernels()->yuv,
+                    x86Ssse3Kernels()->yuvR,
+                    x86Ssse3Kernels()->yuv2,
+                    x86Ssse3Kernels()->lut3d,
+            };
+            return &kernels;
+        }
+    };
+
+}  // namespace
+}  // namespace renderscript
+
+#endif  // ANDROID_RENDERSCRIPT_TOOLKIT_X86_WIDE_H
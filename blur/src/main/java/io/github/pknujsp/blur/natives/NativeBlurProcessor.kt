@@ -3,7 +3,11 @@ package io.github.pknujsp.blur.natives
 import android.graphics.Bitmap
 
 interface NativeBlurProcessor {
-  fun prepareBlur(width: Int, height: Int, radius: Int, resizeRatio: Double)
+  /**
+   * @param blurAlpha blurs the alpha channel together with the colors, for translucent premultiplied bitmaps.
+   * When false, every pixel keeps its original alpha.
+   */
+  fun prepareBlur(width: Int, height: Int, radius: Int, resizeRatio: Double, blurAlpha: Boolean = false)
 
   fun blur(srcBitmap: Bitmap): Bitmap?
 
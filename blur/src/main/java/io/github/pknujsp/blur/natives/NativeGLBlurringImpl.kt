@@ -13,11 +13,33 @@ class NativeGLBlurringImpl {
     external fun onSurfaceChanged(width: Int, height: Int, collectingViewRect: IntArray, windowRect: IntArray)
     external fun onDrawFrame(bitmap: Bitmap?)
 
-    external fun blurAndDrawFrame(srcBitmap: Bitmap)
+    /**
+     * Copies the bitmap into a hardware buffer that the GL context samples directly, or a recycled
+     * native buffer when it can't, blurs it there unless [blur] is false, and hands it to the next
+     * [onDrawFrame] with a null bitmap. The bitmap can be drawn into again as soon as this returns.
+     */
+    external fun blurAndDrawFrame(srcBitmap: Bitmap, blur: Boolean)
 
+    /**
+     * Prepares the blur and the buffers of the frames of [blurAndDrawFrame] for width x height bitmaps.
+     */
     external fun prepareBlur(width: Int, height: Int, radius: Int, resizeRatio: Double)
 
+    /**
+     * Asks for the GPU blur of the frames given to [onDrawFrame]. Call it on the GL thread after
+     * [onSurfaceCreated]; [onSurfaceChanged] prepares it for the size of the surface.
+     */
+    external fun requestGpuBlur(radius: Int, resizeRatio: Double)
 
+    /**
+     * Whether [onSurfaceChanged] prepared the GPU blur. If it couldn't, the context can't run it and
+     * the frames need to be blurred on the CPU as before.
+     */
+    external fun isGpuBlurPrepared(): Boolean
+
+    /**
+     * Deletes the GL objects of the view. Must run on the GL thread, before the context is lost.
+     */
     external fun onPause()
   }
 }
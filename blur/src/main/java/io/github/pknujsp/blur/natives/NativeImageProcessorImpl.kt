@@ -9,7 +9,7 @@ object NativeImageProcessorImpl : NativeBlurProcessor {
   }
 
 
-  external override fun prepareBlur(width: Int, height: Int, radius: Int, resizeRatio: Double)
+  external override fun prepareBlur(width: Int, height: Int, radius: Int, resizeRatio: Double, blurAlpha: Boolean)
 
   external override fun blur(srcBitmap: Bitmap): Bitmap?
 
@@ -7,6 +7,12 @@ import android.renderscript.Element
 import android.renderscript.RenderScript
 import android.renderscript.ScriptIntrinsicBlur
 import io.github.pknujsp.blur.toolkit.Toolkit
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.ExperimentalCoroutinesApi
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.launch
+import java.io.File
 import kotlin.properties.Delegates
 
 @Suppress("deprecation")
@@ -17,10 +23,21 @@ object BlurScript {
   private var srcAllocation: Allocation? = null
   private var outAllocation: Allocation? = null
   private var radius = 0
+  private var tuningFile: File? = null
+
+  /**
+   * Reads and writes the tuning file off the main thread, one at a time so that a save never races
+   * the load before it.
+   */
+  @OptIn(ExperimentalCoroutinesApi::class)
+  private val tuningScope = CoroutineScope(Dispatchers.IO.limitedParallelism(1) + SupervisorJob())
 
   fun init(context: Context) {
     if (!initialized) {
       renderScript = RenderScript.create(context)
+      tuningFile = File(context.noBackupFilesDir, "renderscript-toolkit-tuning").also {
+        tuningScope.launch { Toolkit.loadTuning(it) }
+      }
       initialized = true
     }
     blurScript = ScriptIntrinsicBlur.create(renderScript, Element.U8_4(renderScript))
@@ -50,6 +67,7 @@ object BlurScript {
 
 
   fun onClear() {
+    tuningFile?.let { tuningScope.launch { Toolkit.saveTuning(it) } }
     try {
       blurScript?.destroy()
       renderScript.destroy()
@@ -2,6 +2,10 @@ package io.github.pknujsp.blur.toolkit
 
 
 import android.graphics.Bitmap
+import android.graphics.ImageFormat
+import android.media.Image
+import java.io.File
+import java.nio.ByteBuffer
 
 // This string is used for error messages.
 private const val externalName = "RenderScript Toolkit"
@@ -132,10 +136,12 @@ object Toolkit {
    * Performs a Gaussian blur of an image and returns result in a ByteArray buffer. A variant of
    * this method is available to blur Bitmaps.
    *
-   * The radius determines which pixels are used to compute each blurred pixels. This Toolkit
-   * accepts values between 1 and 25. Larger values create a more blurred effect but also
-   * take longer to compute. When the radius extends past the edge, the edge pixel will
-   * be used as replacement for the pixel that's out off boundary.
+   * The radius determines which pixels are used to compute each blurred pixels. Larger values
+   * create a more blurred effect. Radii up to 25 take longer to compute as they grow. Larger
+   * radii are computed on a copy of the image downscaled to bring the radius back to 25 or
+   * less, then scaled back up, so their cost does not grow with the radius. When the radius
+   * extends past the edge, the edge pixel will be used as replacement for the pixel that's
+   * out off boundary.
    *
    * Each input pixel can either be represented by four bytes (RGBA format) or one byte
    * for the less common blurring of alpha channel only image.
@@ -152,7 +158,7 @@ object Toolkit {
    * @param vectorSize Either 1 or 4, the number of bytes in each cell, i.e. A vs. RGBA.
    * @param sizeX The width of both buffers, as a number of 1 or 4 byte cells.
    * @param sizeY The height of both buffers, as a number of 1 or 4 byte cells.
-   * @param radius The radius of the pixels used to blur, a value from 1 to 25.
+   * @param radius The radius of the pixels used to blur, a value of 1 or more.
    * @param restriction When not null, restricts the operation to a 2D range of pixels.
    * @return The blurred pixels, a ByteArray of size.
    */
@@ -172,8 +178,8 @@ object Toolkit {
       "$externalName blur. inputArray is too small for the given dimensions. " +
         "$sizeX*$sizeY*$vectorSize < ${inputArray.size}."
     }
-    require(radius in 1..25) {
-      "$externalName blur. The radius should be between 1 and 25. $radius provided."
+    require(radius >= 1) {
+      "$externalName blur. The radius should be 1 or more. $radius provided."
     }
     validateRestriction("blur", sizeX, sizeY, restriction)
 
@@ -190,10 +196,12 @@ object Toolkit {
    * Performs a Gaussian blur of a Bitmap and returns result as a Bitmap. A variant of
    * this method is available to blur ByteArrays.
    *
-   * The radius determines which pixels are used to compute each blurred pixels. This Toolkit
-   * accepts values between 1 and 25. Larger values create a more blurred effect but also
-   * take longer to compute. When the radius extends past the edge, the edge pixel will
-   * be used as replacement for the pixel that's out off boundary.
+   * The radius determines which pixels are used to compute each blurred pixels. Larger values
+   * create a more blurred effect. Radii up to 25 take longer to compute as they grow. Larger
+   * radii are computed on a copy of the image downscaled to bring the radius back to 25 or
+   * less, then scaled back up, so their cost does not grow with the radius. When the radius
+   * extends past the edge, the edge pixel will be used as replacement for the pixel that's
+   * out off boundary.
    *
    * This method supports input Bitmap of config ARGB_8888 and ALPHA_8. Bitmaps with a stride
    * different than width * vectorSize are not currently supported. The returned Bitmap has the
@@ -205,15 +213,15 @@ object Toolkit {
    * section that's not blurred all set to 0. This is to stay compatible with RenderScript.
    *
    * @param inputBitmap The buffer of the image to be blurred.
-   * @param radius The radius of the pixels used to blur, a value from 1 to 25. Default is 5.
+   * @param radius The radius of the pixels used to blur, a value of 1 or more. Default is 5.
    * @param restriction When not null, restricts the operation to a 2D range of pixels.
    * @return The blurred Bitmap.
    */
   @JvmOverloads
   fun blur(inputBitmap: Bitmap, radius: Int = 5, restriction: Range2d? = null): Bitmap {
     validateBitmap("blur", inputBitmap)
-    require(radius in 1..25) {
-      "$externalName blur. The radius should be between 1 and 25. $radius provided."
+    require(radius >= 1) {
+      "$externalName blur. The radius should be 1 or more. $radius provided."
     }
     validateRestriction("blur", inputBitmap.width, inputBitmap.height, restriction)
 
@@ -834,8 +842,8 @@ object Toolkit {
    * is returned in the output array.
    *
    * The input array should be in RGBA format, where four consecutive bytes form an cell.
-   * The fourth byte of each input cell is ignored. A variant of this method is also available
-   * to transform Bitmaps.
+   * The fourth byte of each input cell is copied unchanged. A variant of this method is also
+   * available to transform Bitmaps.
    *
    * An optional range parameter can be set to restrict the operation to a rectangular subset
    * of each buffer. If provided, the range must be wholly contained with the dimensions
@@ -926,7 +934,7 @@ object Toolkit {
   /**
    * Resize an image.
    *
-   * Resizes an image using bicubic interpolation.
+   * Resizes an image using bicubic interpolation, or the area filter when given.
    *
    * This method supports elements of 1 to 4 bytes in length. Each byte of the element is
    * interpolated independently from the others.
@@ -948,6 +956,7 @@ object Toolkit {
    * @param outputSizeX The width of the output buffer, as a number of 1-4 byte elements.
    * @param outputSizeY The height of the output buffer, as a number of 1-4 byte elements.
    * @param restriction When not null, restricts the operation to a 2D range of pixels.
+   * @param filter How the input elements are combined. Default is bicubic interpolation.
    * @return An array that contains the rescaled image.
    */
   @JvmOverloads
@@ -959,6 +968,7 @@ object Toolkit {
     outputSizeX: Int,
     outputSizeY: Int,
     restriction: Range2d? = null,
+    filter: ResizeFilter = ResizeFilter.BICUBIC,
   ): ByteArray {
     require(vectorSize in 1..4) {
       "$externalName resize. The vectorSize should be between 1 and 4. $vectorSize provided."
@@ -979,6 +989,7 @@ object Toolkit {
       outputArray,
       outputSizeX,
       outputSizeY,
+      filter.value,
       restriction,
     )
     return outputArray
@@ -987,7 +998,7 @@ object Toolkit {
   /**
    * Resize an image.
    *
-   * Resizes an image using bicubic interpolation.
+   * Resizes an image using bicubic interpolation, or the area filter when given.
    *
    * This method supports input Bitmap of config ARGB_8888 and ALPHA_8. The returned Bitmap
    * has the same config. Bitmaps with a stride different than width * vectorSize are not
@@ -1002,6 +1013,7 @@ object Toolkit {
    * @param outputSizeX The width of the output buffer, as a number of 1-4 byte elements.
    * @param outputSizeY The height of the output buffer, as a number of 1-4 byte elements.
    * @param restriction When not null, restricts the operation to a 2D range of pixels.
+   * @param filter How the input elements are combined. Default is bicubic interpolation.
    * @return A Bitmap that contains the rescaled image.
    */
   @JvmOverloads
@@ -1010,12 +1022,13 @@ object Toolkit {
     outputSizeX: Int,
     outputSizeY: Int,
     restriction: Range2d? = null,
+    filter: ResizeFilter = ResizeFilter.BICUBIC,
   ): Bitmap {
     validateBitmap("resize", inputBitmap)
     validateRestriction("resize", outputSizeX, outputSizeY, restriction)
 
-    val outputBitmap = Bitmap.createBitmap(outputSizeX, outputSizeY, Bitmap.Config.ARGB_8888)
-    nativeResizeBitmap(nativeHandle, inputBitmap, outputBitmap, restriction)
+    val outputBitmap = Bitmap.createBitmap(outputSizeX, outputSizeY, inputBitmap.config)
+    nativeResizeBitmap(nativeHandle, inputBitmap, outputBitmap, filter.value, restriction)
     return outputBitmap
   }
 
@@ -1071,6 +1084,110 @@ object Toolkit {
     return outputBitmap
   }
 
+  /**
+   * Convert a YUV_420_888 Image, like a camera frame, to an RGB Bitmap.
+   *
+   * The planes of the image are read in place, whatever their row and pixel strides. The output
+   * is RGBA; the alpha channel will be set to 255.
+   *
+   * @param image The image to be converted. Its format must be ImageFormat.YUV_420_888.
+   * @return The converted image.
+   */
+  fun yuvToRgbBitmap(image: Image): Bitmap {
+    validateYuvImage("yuvToRgbBitmap", image)
+
+    val outputBitmap = Bitmap.createBitmap(image.width, image.height, Bitmap.Config.ARGB_8888)
+    val planes = image.planes
+    nativeYuvPlanesToRgbBitmap(
+      nativeHandle, planes[0].buffer, planes[1].buffer, planes[2].buffer, planes[0].rowStride,
+      planes[1].rowStride, planes[1].pixelStride, image.width, image.height, outputBitmap,
+    )
+    return outputBitmap
+  }
+
+  /**
+   * Blur a YUV_420_888 Image, like a camera frame, into an RGB Bitmap.
+   *
+   * The image is converted to RGBA in a native buffer that is reused from frame to frame, then
+   * blurred into the returned Bitmap. No converted copy of the frame is made on the Java side.
+   *
+   * @param image The image to be blurred. Its format must be ImageFormat.YUV_420_888.
+   * @param radius The radius of the pixels used to blur, a value of 1 or more. Default is 5.
+   * @return The blurred image.
+   */
+  @JvmOverloads
+  fun blur(image: Image, radius: Int = 5): Bitmap {
+    validateYuvImage("blur", image)
+    require(radius >= 1) {
+      "$externalName blur. The radius should be 1 or more. $radius provided."
+    }
+
+    val outputBitmap = Bitmap.createBitmap(image.width, image.height, Bitmap.Config.ARGB_8888)
+    val planes = image.planes
+    nativeBlurYuvPlanesBitmap(
+      nativeHandle, planes[0].buffer, planes[1].buffer, planes[2].buffer, planes[0].rowStride,
+      planes[1].rowStride, planes[1].pixelStride, image.width, image.height, outputBitmap, radius,
+    )
+    return outputBitmap
+  }
+
+  /**
+   * Resize, blur, transform and blend an image in a single pass.
+   *
+   * Gives about the same image as calling resize, blur, colorMatrix and blend in turn, without
+   * the three intermediate Bitmaps: each tile of the output goes through all the operations while
+   * it is in the cache of its thread. The values are not rounded between the operations, so the
+   * result may differ from the separate calls by one.
+   *
+   * Each operation is skipped when its parameters are left to their defaults.
+   *
+   * @param inputBitmap The ARGB_8888 Bitmap to be processed.
+   * @param outputSizeX The width of the returned Bitmap. The input is resized to it.
+   * @param outputSizeY The height of the returned Bitmap.
+   * @param resizeFilter How the input elements are combined by the resize.
+   * @param blurRadius The radius of the blur, from 0 to 25. 0 skips the blur.
+   * @param colorMatrix A 4x4 matrix as in colorMatrix. Null skips the transform.
+   * @param colorAddVector The vector added after the matrix, as in colorMatrix.
+   * @param blendMode How blendColor is blended into the image, as the source of blend.
+   * @param blendColor A color, as an ARGB Int that is not premultiplied.
+   * @return A Bitmap that contains the processed image.
+   */
+  @JvmOverloads
+  fun pipeline(
+    inputBitmap: Bitmap,
+    outputSizeX: Int = inputBitmap.width,
+    outputSizeY: Int = inputBitmap.height,
+    resizeFilter: ResizeFilter = ResizeFilter.AREA,
+    blurRadius: Float = 0f,
+    colorMatrix: FloatArray? = null,
+    colorAddVector: FloatArray? = null,
+    blendMode: BlendingMode = BlendingMode.DST,
+    blendColor: Int = 0,
+  ): Bitmap {
+    validateBitmap("pipeline", inputBitmap, alphaAllowed = false)
+    require(outputSizeX >= 1 && outputSizeY >= 1) {
+      "$externalName pipeline. The output size should be at least 1x1. " +
+        "${outputSizeX}x$outputSizeY provided."
+    }
+    require(blurRadius in 0f..25f) {
+      "$externalName pipeline. The blurRadius should be between 0 and 25. $blurRadius provided."
+    }
+    require(colorMatrix == null || colorMatrix.size == 16) {
+      "$externalName pipeline. colorMatrix should have 16 entries. ${colorMatrix?.size} provided."
+    }
+    require(colorAddVector == null || colorAddVector.size == 4) {
+      "$externalName pipeline. colorAddVector should have 4 entries. " +
+        "${colorAddVector?.size} provided."
+    }
+
+    val outputBitmap = Bitmap.createBitmap(outputSizeX, outputSizeY, Bitmap.Config.ARGB_8888)
+    nativePipelineBitmap(
+      nativeHandle, inputBitmap, outputBitmap, resizeFilter.value, blurRadius, colorMatrix,
+      colorAddVector, blendMode.value, blendColor,
+    )
+    return outputBitmap
+  }
+
   private var nativeHandle: Long = 0
 
   init {
@@ -1091,10 +1208,33 @@ object Toolkit {
     nativeHandle = 0
   }
 
+  /**
+   * Load the tilings learned by a previous run of the application.
+   *
+   * The toolkit picks the tile size and the number of threads of each operation from the size of
+   * the image and the caches of the device, and adjusts them from the time the operations take.
+   * Loading the choices saved by [saveTuning] skips most of that learning.
+   *
+   * @param file A file written by [saveTuning], typically in Context.noBackupFilesDir.
+   * @return False if the file can't be read or was saved on another device.
+   */
+  fun loadTuning(file: File): Boolean = nativeLoadTuning(nativeHandle, file.path)
+
+  /**
+   * Save the tilings learned so far, to be loaded by [loadTuning] the next time.
+   *
+   * @return False if the file can't be written.
+   */
+  fun saveTuning(file: File): Boolean = nativeSaveTuning(nativeHandle, file.path)
+
   private external fun createNative(): Long
 
   private external fun destroyNative(nativeHandle: Long)
 
+  private external fun nativeLoadTuning(nativeHandle: Long, path: String): Boolean
+
+  private external fun nativeSaveTuning(nativeHandle: Long, path: String): Boolean
+
   private external fun nativeBlend(
     nativeHandle: Long,
     mode: Int,
@@ -1266,6 +1406,7 @@ object Toolkit {
     outputArray: ByteArray,
     outputSizeX: Int,
     outputSizeY: Int,
+    filter: Int,
     restriction: Range2d?,
   )
 
@@ -1273,6 +1414,7 @@ object Toolkit {
     nativeHandle: Long,
     inputBitmap: Bitmap,
     outputBitmap: Bitmap,
+    filter: Int,
     restriction: Range2d?,
   )
 
@@ -1293,6 +1435,45 @@ object Toolkit {
     outputBitmap: Bitmap,
     value: Int,
   )
+
+  private external fun nativeYuvPlanesToRgbBitmap(
+    nativeHandle: Long,
+    yBuffer: ByteBuffer,
+    uBuffer: ByteBuffer,
+    vBuffer: ByteBuffer,
+    yRowStride: Int,
+    uvRowStride: Int,
+    uvPixelStride: Int,
+    sizeX: Int,
+    sizeY: Int,
+    outputBitmap: Bitmap,
+  )
+
+  private external fun nativeBlurYuvPlanesBitmap(
+    nativeHandle: Long,
+    yBuffer: ByteBuffer,
+    uBuffer: ByteBuffer,
+    vBuffer: ByteBuffer,
+    yRowStride: Int,
+    uvRowStride: Int,
+    uvPixelStride: Int,
+    sizeX: Int,
+    sizeY: Int,
+    outputBitmap: Bitmap,
+    radius: Int,
+  )
+
+  private external fun nativePipelineBitmap(
+    nativeHandle: Long,
+    inputBitmap: Bitmap,
+    outputBitmap: Bitmap,
+    resizeFilter: Int,
+    blurRadius: Float,
+    colorMatrix: FloatArray?,
+    colorAddVector: FloatArray?,
+    blendMode: Int,
+    blendColor: Int,
+  )
 }
 
 /**
@@ -1401,6 +1582,17 @@ class LookupTable {
   var alpha = ByteArray(256) { it.toByte() }
 }
 
+/**
+ * The filters supported by resize.
+ */
+enum class ResizeFilter(val value: Int) {
+  /** Catmull-Rom bicubic interpolation. */
+  BICUBIC(0),
+
+  /** Each output element averages the input elements it covers. Best to scale down by large factors. */
+  AREA(1),
+}
+
 /**
  * The YUV formats supported by yuvToRgb.
  */
@@ -1481,6 +1673,21 @@ internal fun validateBitmap(
   }
 }
 
+internal fun validateYuvImage(function: String, image: Image) {
+  require(image.format == ImageFormat.YUV_420_888) {
+    "$externalName $function. Only YUV_420_888 images are supported. ${image.format} provided."
+  }
+  val chroma = image.planes[1]
+  require(chroma.pixelStride == 1 || chroma.pixelStride == 2) {
+    "$externalName $function. The chroma pixel stride should be 1 or 2. " +
+      "${chroma.pixelStride} provided."
+  }
+  require(image.planes[2].rowStride == chroma.rowStride &&
+    image.planes[2].pixelStride == chroma.pixelStride) {
+    "$externalName $function. The U and V planes should have the same strides."
+  }
+}
+
 internal fun createCompatibleBitmap(inputBitmap: Bitmap) =
   Bitmap.createBitmap(inputBitmap.width, inputBitmap.height, inputBitmap.config)
 
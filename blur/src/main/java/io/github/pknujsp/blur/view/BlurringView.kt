@@ -3,8 +3,11 @@ package io.github.pknujsp.blur.view
 import IGLSurfaceView
 import IGLSurfaceViewLayout
 import android.app.Activity
+import android.app.ActivityManager
 import android.content.Context
 import android.graphics.Bitmap
+import android.graphics.Canvas
+import android.graphics.Color
 import android.graphics.Rect
 import android.opengl.GLSurfaceView
 import android.view.View
@@ -12,19 +15,13 @@ import android.view.ViewGroup
 import android.view.ViewTreeObserver
 import android.view.Window
 import android.widget.FrameLayout
-import androidx.core.view.drawToBitmap
 import io.github.pknujsp.blur.BlurUtils.getCoordinatesInWindow
 import io.github.pknujsp.blur.R
 import io.github.pknujsp.blur.natives.NativeGLBlurringImpl
-import io.github.pknujsp.blur.renderscript.BlurScript
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.DelicateCoroutinesApi
 import kotlinx.coroutines.SupervisorJob
 import kotlinx.coroutines.cancel
-import kotlinx.coroutines.channels.BufferOverflow
-import kotlinx.coroutines.channels.Channel
-import kotlinx.coroutines.channels.onSuccess
-import kotlinx.coroutines.flow.consumeAsFlow
 import kotlinx.coroutines.isActive
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.newSingleThreadContext
@@ -47,35 +44,46 @@ class BlurringView private constructor(context: Context) : GLSurfaceView(context
 
   private val viewMutex = Mutex()
 
-  private val srcBitmapChannel = Channel<Bitmap>(capacity = 30, onBufferOverflow = BufferOverflow.SUSPEND)
-  private val blurredBitmapChannel = Channel<Bitmap>(capacity = 30, onBufferOverflow = BufferOverflow.SUSPEND)
+  /**
+   * Whether the frames should be blurred on the GPU. They are blurred on the CPU until the GL
+   * context has prepared the GPU blur, and for good if it can't.
+   */
+  private var useGpuBlur = false
+
+  @Volatile
+  private var gpuBlurActive = false
+
+  /**
+   * Low-RAM devices capture the opaque backdrop as RGB_565, which halves the bitmap memory and the
+   * bandwidth of the blur and the texture upload.
+   */
+  private val backdropConfig: Bitmap.Config by lazy {
+    if ((context.getSystemService(Context.ACTIVITY_SERVICE) as ActivityManager).isLowRamDevice) Bitmap.Config.RGB_565
+    else Bitmap.Config.ARGB_8888
+  }
+
+  /**
+   * The backdrop is drawn into this bitmap on every frame rather than into a new one, and copied out
+   * of it into the recycled native buffers of [NativeGLBlurringImpl.blurAndDrawFrame]. Only used under
+   * [viewMutex].
+   */
+  private var captureBitmap: Bitmap? = null
+  private var captureCanvas: Canvas? = null
 
   private val copyScope = CoroutineScope(copyThread) + SupervisorJob()
-  private val blurScope = CoroutineScope(blurThread) + SupervisorJob()
 
   @OptIn(DelicateCoroutinesApi::class)
   private companion object {
-    val blurThread = newSingleThreadContext("blurThread")
     val copyThread = newSingleThreadContext("copyThread")
   }
 
-  init {
-    blurScope.launch {
-      srcBitmapChannel.consumeAsFlow().collect { bitmap ->
-        BlurScript.instrinsicBlur(bitmap)?.also {
-          blurredBitmapChannel.send(bitmap)
-          this@BlurringView.queueEvent { requestRender() }
-        }
-      }
-    }
-  }
-
   private val onPreDrawListener = ViewTreeObserver.OnPreDrawListener {
     copyScope.launch {
       if (!viewMutex.isLocked) {
         viewMutex.withLock {
-          collectingView?.drawToBitmap()?.run {
-            srcBitmapChannel.send(this)
+          collectingView?.let { captureBackdrop(it) }?.let { bitmap ->
+            NativeGLBlurringImpl.blurAndDrawFrame(bitmap, !gpuBlurActive)
+            this@BlurringView.queueEvent { requestRender() }
           }
         }
       }
@@ -83,9 +91,27 @@ class BlurringView private constructor(context: Context) : GLSurfaceView(context
     true
   }
 
-  constructor(context: Context, radius: Int) : this(context) {
+  private fun captureBackdrop(view: View): Bitmap? {
+    if (view.width == 0 || view.height == 0) return null
+
+    val bitmap = captureBitmap?.takeIf { it.width == view.width && it.height == view.height }
+      ?: Bitmap.createBitmap(view.width, view.height, backdropConfig).also {
+        captureBitmap = it
+        captureCanvas = Canvas(it)
+      }
+    captureCanvas?.run {
+      bitmap.eraseColor(Color.TRANSPARENT)
+      save()
+      translate(-view.scrollX.toFloat(), -view.scrollY.toFloat())
+      view.draw(this)
+      restore()
+    }
+    return bitmap
+  }
+
+  constructor(context: Context, radius: Int, useGpuBlur: Boolean = false) : this(context) {
     this.radius = radius
-    BlurScript.init(context)
+    this.useGpuBlur = useGpuBlur
 
     id = R.id.blurring_view
     layoutParams = FrameLayout.LayoutParams(
@@ -109,7 +135,7 @@ class BlurringView private constructor(context: Context) : GLSurfaceView(context
           windowRect.right = window.decorView.width
           windowRect.bottom = window.decorView.height
 
-          BlurScript.prepare(radius)
+          NativeGLBlurringImpl.prepareBlur(width, height, radius, 1.0)
           viewTreeObserver.addOnPreDrawListener(onPreDrawListener)
         }
       }
@@ -119,6 +145,7 @@ class BlurringView private constructor(context: Context) : GLSurfaceView(context
 
   override fun onSurfaceCreated(gl: GL10?, config: EGLConfig?) {
     NativeGLBlurringImpl.onSurfaceCreated(this)
+    if (useGpuBlur) NativeGLBlurringImpl.requestGpuBlur(radius, 1.0)
   }
 
   override fun onSurfaceChanged(gl: GL10?, width: Int, height: Int) {
@@ -131,21 +158,21 @@ class BlurringView private constructor(context: Context) : GLSurfaceView(context
         intArrayOf(left, top, right, bottom)
       },
     )
+    gpuBlurActive = useGpuBlur && NativeGLBlurringImpl.isGpuBlurPrepared()
   }
 
   override fun onDrawFrame(gl: GL10?) {
-    blurredBitmapChannel.tryReceive().onSuccess {
-      NativeGLBlurringImpl.onDrawFrame(it)
-    }
+    // Draws the newest frame of blurAndDrawFrame, or the last one again.
+    NativeGLBlurringImpl.onDrawFrame(null)
   }
 
   override fun onPause() {
     collectingView?.viewTreeObserver?.removeOnPreDrawListener(onPreDrawListener)
-    if (blurScope.isActive) blurScope.cancel()
     if (copyScope.isActive) copyScope.cancel()
-    BlurScript.onClear()
+    // Deletes the GL objects on the GL thread while its context is still current. The queued events
+    // run before the pause, and super.onPause() waits for it.
+    queueEvent { NativeGLBlurringImpl.onPause() }
     super.onPause()
-    NativeGLBlurringImpl.onPause()
     collectingView = null
     window = null
   }
@@ -0,0 +1,113 @@
+#include "PixelBufferPool.h"
+#include "TestCheck.h"
+#include <cstdint>
+#include <utility>
+
+static bool isAligned(const uint8_t *bytes) {
+    return (uintptr_t) bytes % PixelBufferPool::kAlignment == 0;
+}
+
+static void testPreparedBuffersAreAlignedAndRoundedUp() {
+    PixelBufferPool pool;
+    pool.prepare(1000, 2);
+    PixelBufferPool::Buffer first = pool.acquire(1000);
+    PixelBufferPool::Buffer second = pool.acquire(10);
+    CHECK(first.data() != nullptr and second.data() != nullptr);
+    CHECK(first.data() != second.data());
+    CHECK(isAligned(first.data()) and isAligned(second.data()));
+    CHECK(first.size() == 1024 and second.size() == 1024);
+}
+
+static void testReturnedBuffersAreRecycled() {
+    PixelBufferPool pool;
+    pool.prepare(4096, 1);
+    PixelBufferPool::Buffer buffer = pool.acquire(4096);
+    const uint8_t *bytes = buffer.data();
+    buffer.reset();
+    CHECK(buffer.data() == nullptr and buffer.size() == 0);
+
+    PixelBufferPool::Buffer again = pool.acquire(100);
+    CHECK(again.data() == bytes);
+    CHECK(again.size() == 4096);
+}
+
+static void testBuffersPreparedLazilyAreRecycled() {
+    PixelBufferPool pool;
+    pool.prepare(1000, 0);
+    PixelBufferPool::Buffer buffer = pool.acquire(10);
+    const uint8_t *bytes = buffer.data();
+    CHECK(bytes != nullptr and isAligned(bytes));
+    CHECK(buffer.size() == 1024);
+    buffer.reset();
+
+    PixelBufferPool::Buffer again = pool.acquire(1000);
+    CHECK(again.data() == bytes);
+}
+
+static void testLargerBuffersAreNotKept() {
+    PixelBufferPool pool;
+    pool.prepare(256, 1);
+    PixelBufferPool::Buffer prepared = pool.acquire(256);
+    PixelBufferPool::Buffer large = pool.acquire(5000);
+    CHECK(large.data() != nullptr and isAligned(large.data()));
+    CHECK(large.size() == 5056);
+    large.reset();
+
+    // The large buffer was freed, not recycled: the next one is allocated at the prepared size.
+    PixelBufferPool::Buffer next = pool.acquire(100);
+    CHECK(next.data() != nullptr and isAligned(next.data()));
+    CHECK(next.size() == 256);
+}
+
+static void testBuffersOfAPreviousSizeAreNotRecycled() {
+    PixelBufferPool pool;
+    pool.prepare(256, 1);
+    PixelBufferPool::Buffer held = pool.acquire(256);
+    pool.prepare(2048, 1);
+    held.reset();
+
+    PixelBufferPool::Buffer first = pool.acquire(10);
+    PixelBufferPool::Buffer second = pool.acquire(10);
+    CHECK(first.size() == 2048 and second.size() == 2048);
+}
+
+static void testClearFreesBuffersStillHeld() {
+    PixelBufferPool pool;
+    pool.prepare(2048, 2);
+    PixelBufferPool::Buffer held = pool.acquire(2048);
+    pool.clear();
+    held.reset();
+
+    // Nothing is prepared any more, the next buffer is only as large as asked for.
+    PixelBufferPool::Buffer next = pool.acquire(100);
+    CHECK(next.data() != nullptr and isAligned(next.data()));
+    CHECK(next.size() == 128);
+}
+
+static void testMovedBuffersChangeOwner() {
+    PixelBufferPool pool;
+    pool.prepare(64, 2);
+    PixelBufferPool::Buffer first = pool.acquire(64);
+    const uint8_t *bytes = first.data();
+
+    PixelBufferPool::Buffer moved = std::move(first);
+    CHECK(first.data() == nullptr and first.size() == 0);
+    CHECK(moved.data() == bytes and moved.size() == 64);
+
+    // Assigning another buffer gives the one held back to the pool.
+    moved = pool.acquire(64);
+    CHECK(moved.data() != bytes);
+    PixelBufferPool::Buffer recycled = pool.acquire(64);
+    CHECK(recycled.data() == bytes);
+}
+
+int main() {
+    testPreparedBuffersAreAlignedAndRoundedUp();
+    testReturnedBuffersAreRecycled();
+    testBuffersPreparedLazilyAreRecycled();
+    testLargerBuffersAreNotKept();
+    testBuffersOfAPreviousSizeAreNotRecycled();
+    testClearFreesBuffersStillHeld();
+    testMovedBuffersChangeOwner();
+    return failedChecks == 0 ? 0 : 1;
+}
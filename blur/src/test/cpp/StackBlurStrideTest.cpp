@@ -0,0 +1,102 @@
+#include "TestCheck.h"
+#include "PixelBufferPool.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "BlurManager.h"
+
+// Declared by host/HostToolkit.h. The vector kernels are only there when the target has them.
+bool renderscript::cpuSupportsSimd() { return true; }
+
+// Written into the padding of the rows, which the blur must leave alone.
+static constexpr uint32_t kPadding = 0x5a5a5a5a;
+
+/**
+ * Stands in for a locked AHardwareBuffer: heap rows padded to a stride the way gralloc pads them, to
+ * a multiple of strideAlignment pixels.
+ */
+template<typename T>
+struct PaddedFrame {
+    PixelBufferPool::Buffer storage;
+    uint32_t stride;
+
+    PaddedFrame(PixelBufferPool &pool, uint32_t width, uint32_t height, uint32_t strideAlignment)
+            : stride((width + strideAlignment - 1) / strideAlignment * strideAlignment) {
+        storage = pool.acquire(sizeof(T) * stride * height);
+    }
+
+    T *row(uint32_t y) const { return (T *) storage.data() + (size_t) y * stride; }
+};
+
+/**
+ * Blurs the same random frame packed and in padded rows, as blurAndDrawFrame does for a hardware
+ * buffer, and returns whether the pixels match and the padding is untouched.
+ */
+template<typename T>
+static bool blursPaddedRowsLikePackedOnes(Blur<T> *engine, PixelBufferPool &pool, uint32_t width, uint32_t height,
+                                          uint32_t strideAlignment, const BlurOptions &options) {
+    std::vector<T> packed((size_t) width * height);
+    for (T &pixel: packed) pixel = (T) ((uint32_t) rand() * 2654435761u);
+
+    PaddedFrame<T> padded(pool, width, height, strideAlignment);
+    if (padded.storage.data() == nullptr) return false;
+    for (uint32_t y = 0; y < height; y++) {
+        memcpy(padded.row(y), &packed[(size_t) y * width], sizeof(T) * width);
+        std::fill(padded.row(y) + width, padded.row(y) + padded.stride, (T) kPadding);
+    }
+
+    // Prepared at the frame size once, both blurs then reuse it.
+    const AndroidBitmapInfo packedInfo{width, height, (uint32_t) sizeof(T) * width, 0, 0};
+    AndroidBitmapInfo paddedInfo = packedInfo;
+    paddedInfo.stride = (uint32_t) sizeof(T) * padded.stride;
+    if (not blurBitmapPixels(engine, options, packed.data(), packedInfo)) return false;
+    if (not blurBitmapPixels(engine, options, padded.storage.data(), paddedInfo)) return false;
+
+    for (uint32_t y = 0; y < height; y++) {
+        if (memcmp(padded.row(y), &packed[(size_t) y * width], sizeof(T) * width) != 0) return false;
+        for (uint32_t x = width; x < padded.stride; x++) {
+            if (padded.row(y)[x] != (T) kPadding) return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+static void testPaddedRows(Blur<T> *engine, AlphaMode alphaMode) {
+    PixelBufferPool pool;
+    for (double resizeRatio: {1.0, 2.5, 4.0}) {
+        for (int radius: {1, 8, 25}) {
+            const BlurOptions options{radius, resizeRatio, alphaMode};
+            for (uint32_t width: {97u, 128u, 130u}) {
+                for (uint32_t strideAlignment: {1u, 16u, 64u}) {
+                    engine->onDestroy();
+                    const bool same = blursPaddedRowsLikePackedOnes(engine, pool, width, 61, strideAlignment, options);
+                    if (not same) {
+                        fprintf(stderr, "width %u, stride alignment %u, radius %d, resize ratio %.1f:\n", width,
+                                strideAlignment, radius, resizeRatio);
+                    }
+                    CHECK(same);
+                }
+            }
+        }
+    }
+}
+
+static void testRejectsStrideOfPartialPixels() {
+    ABGRStackBlur engine;
+    std::vector<uint32_t> pixels(8 * 8 + 1);
+    const AndroidBitmapInfo info{8, 8, 8 * sizeof(uint32_t) + 2, 0, 0};
+    CHECK(not blurBitmapPixels(&engine, BlurOptions{4, 1.0, AlphaMode::OPAQUE}, pixels.data(), info));
+}
+
+int main() {
+    ABGRStackBlur abgr;
+    RGBStackBlur rgb;
+    testPaddedRows<unsigned int>(&abgr, AlphaMode::OPAQUE);
+    testPaddedRows<unsigned int>(&abgr, AlphaMode::PREMULTIPLIED);
+    testPaddedRows<unsigned short>(&rgb, AlphaMode::OPAQUE);
+    testRejectsStrideOfPartialPixels();
+    return failedChecks == 0 ? 0 : 1;
+}
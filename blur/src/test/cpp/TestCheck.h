@@ -0,0 +1,18 @@
+#ifndef TESTBED_TESTCHECK_H
+#define TESTBED_TESTCHECK_H
+
+#include <cstdio>
+
+// Failed checks of the test, its exit status is whether there were any.
+static int failedChecks = 0;
+
+// Reports a failed condition and carries on, so that one run shows all of them.
+#define CHECK(condition) \
+    do { \
+        if (not (condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failedChecks++; \
+        } \
+    } while (false)
+
+#endif //TESTBED_TESTCHECK_H
@@ -0,0 +1,80 @@
+#include "RenderScriptToolkit.h"
+#include "TestCheck.h"
+#include <cstdint>
+#include <vector>
+
+using namespace renderscript;
+
+// Wide enough for blocks of the x86 kernels and a tail, and for an interior between the borders.
+static constexpr size_t kSizeX = 23;
+static constexpr size_t kSizeY = 7;
+
+static std::vector<uint8_t> uniformImage(uint8_t value) {
+    return std::vector<uint8_t>(kSizeX * kSizeY * 4, value);
+}
+
+// Whether all the pixels came out as the first one, border, interior and tail alike.
+static bool isUniform(const std::vector<uint8_t> &image) {
+    for (size_t i = 4; i < image.size(); i++) {
+        if (image[i] != image[i % 4]) return false;
+    }
+    return true;
+}
+
+static void testConvolveWithLargeCoefficients(RenderScriptToolkit &toolkit) {
+    const std::vector<uint8_t> white = uniformImage(255);
+    std::vector<uint8_t> out(white.size());
+
+    // Each coefficient passes validation, their sum saturates every channel.
+    float coefficients3x3[9];
+    for (float &coefficient: coefficients3x3) coefficient = 20.f;
+    toolkit.convolve3x3(white.data(), out.data(), 4, kSizeX, kSizeY, coefficients3x3);
+    CHECK(isUniform(out));
+    CHECK(out[0] == 255);
+
+    float coefficients5x5[25];
+    for (float &coefficient: coefficients5x5) coefficient = 10.f;
+    toolkit.convolve5x5(white.data(), out.data(), 4, kSizeX, kSizeY, coefficients5x5);
+    CHECK(isUniform(out));
+    CHECK(out[0] == 255);
+
+    // Large coefficients of both signs that cancel out keep the image.
+    for (int i = 0; i < 9; i++) coefficients3x3[i] = i == 4 ? 1.f : (i % 2 == 0 ? 100.f : -100.f);
+    toolkit.convolve3x3(white.data(), out.data(), 4, kSizeX, kSizeY, coefficients3x3);
+    CHECK(isUniform(out));
+    CHECK(out[0] == 255);
+}
+
+static void testColorMatrixWithLargeCoefficients(RenderScriptToolkit &toolkit) {
+    const std::vector<uint8_t> white = uniformImage(255);
+    std::vector<uint8_t> out(white.size());
+
+    // Every color coefficient at 64 and alpha copied: the sums of the 3x3 and dot shapes saturate.
+    float matrix[16];
+    for (int i = 0; i < 16; i++) matrix[i] = i % 4 == 3 or i / 4 == 3 ? 0.f : 64.f;
+    matrix[15] = 1.f;
+    toolkit.colorMatrix(white.data(), out.data(), 4, 4, kSizeX, kSizeY, matrix);
+    CHECK(isUniform(out));
+    CHECK(out[0] == 255 and out[1] == 255 and out[2] == 255 and out[3] == 255);
+
+    // And the general shape, with alpha mixed in.
+    for (float &coefficient: matrix) coefficient = 64.f;
+    toolkit.colorMatrix(white.data(), out.data(), 4, 4, kSizeX, kSizeY, matrix);
+    CHECK(isUniform(out));
+    CHECK(out[0] == 255 and out[3] == 255);
+
+    // A dot product with one color per channel.
+    for (int i = 0; i < 16; i++) matrix[i] = i % 4 == 3 or i / 4 == 3 ? 0.f : 100.f;
+    matrix[15] = 1.f;
+    const std::vector<uint8_t> gray = uniformImage(128);
+    toolkit.colorMatrix(gray.data(), out.data(), 4, 4, kSizeX, kSizeY, matrix);
+    CHECK(isUniform(out));
+    CHECK(out[0] == 255 and out[3] == 128);
+}
+
+int main() {
+    RenderScriptToolkit toolkit;
+    testConvolveWithLargeCoefficients(toolkit);
+    testColorMatrixWithLargeCoefficients(toolkit);
+    return failedChecks == 0 ? 0 : 1;
+}
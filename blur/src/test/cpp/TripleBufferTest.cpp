@@ -0,0 +1,109 @@
+#include "TripleBuffer.h"
+#include "TestCheck.h"
+#include <cstdint>
+#include <thread>
+
+struct Value {
+    uint64_t sequence = 0;
+    // Written along with sequence, a torn handoff leaves them different.
+    uint64_t copies[7] = {};
+};
+
+static void write(Value &value, uint64_t sequence) {
+    value.sequence = sequence;
+    for (uint64_t &copy: value.copies) copy = sequence;
+}
+
+static bool isWhole(const Value &value) {
+    for (uint64_t copy: value.copies) {
+        if (copy != value.sequence) return false;
+    }
+    return true;
+}
+
+static void testNothingToAcquireBeforePublish() {
+    TripleBuffer<Value> buffer;
+    CHECK(not buffer.acquire());
+}
+
+static void testAcquireTakesThePublishedSlotOnce() {
+    TripleBuffer<Value> buffer;
+    Value *written = &buffer.back();
+    write(*written, 1);
+    buffer.publish();
+    // The producer got another slot to write into.
+    CHECK(&buffer.back() != written);
+
+    CHECK(buffer.acquire());
+    CHECK(&buffer.front() == written);
+    CHECK(buffer.front().sequence == 1);
+    // The fresh bit went with the slot, the same value isn't handed out twice.
+    CHECK(not buffer.acquire());
+    CHECK(&buffer.front() == written);
+}
+
+static void testPublishOverwritesAValueNotTaken() {
+    TripleBuffer<Value> buffer;
+    write(buffer.back(), 1);
+    buffer.publish();
+    write(buffer.back(), 2);
+    buffer.publish();
+
+    CHECK(buffer.acquire());
+    CHECK(buffer.front().sequence == 2);
+    CHECK(not buffer.acquire());
+}
+
+static void testProducerAndConsumerNeverShareASlot() {
+    TripleBuffer<Value> buffer;
+    uint64_t sequence = 0;
+    // Every interleaving of up to two publishes between acquires.
+    for (int step = 0; step < 64; step++) {
+        const int publishes = step % 3;
+        for (int i = 0; i < publishes; i++) {
+            write(buffer.back(), ++sequence);
+            buffer.publish();
+            CHECK(&buffer.back() != &buffer.front());
+        }
+        CHECK(buffer.acquire() == (publishes > 0));
+        CHECK(&buffer.back() != &buffer.front());
+        CHECK(buffer.front().sequence == sequence);
+    }
+}
+
+static void testConcurrentHandoff() {
+    constexpr uint64_t kValues = 200000;
+    TripleBuffer<Value> buffer;
+
+    std::thread producer([&buffer] {
+        for (uint64_t sequence = 1; sequence <= kValues; sequence++) {
+            write(buffer.back(), sequence);
+            buffer.publish();
+        }
+    });
+
+    uint64_t last = 0;
+    int torn = 0;
+    int backwards = 0;
+    while (last != kValues) {
+        if (not buffer.acquire()) continue;
+        const Value &value = buffer.front();
+        if (not isWhole(value)) torn++;
+        if (value.sequence <= last) backwards++;
+        last = value.sequence;
+    }
+    producer.join();
+
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(not buffer.acquire());
+}
+
+int main() {
+    testNothingToAcquireBeforePublish();
+    testAcquireTakesThePublishedSlotOnce();
+    testPublishOverwritesAValueNotTaken();
+    testProducerAndConsumerNeverShareASlot();
+    testConcurrentHandoff();
+    return failedChecks == 0 ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+#ifndef TESTBED_HOST_TOOLKIT_H
+#define TESTBED_HOST_TOOLKIT_H
+
+// Included ahead of every source of the engine tests. The toolkit's Utils.h needs clang's vector
+// types, the engines only need cpuSupportsSimd() of it.
+#define ANDROID_RENDERSCRIPT_TOOLKIT_UTILS_H
+
+namespace renderscript {
+    bool cpuSupportsSimd();
+}
+
+#endif //TESTBED_HOST_TOOLKIT_H
@@ -0,0 +1,24 @@
+#ifndef TESTBED_HOST_ANDROID_BITMAP_H
+#define TESTBED_HOST_ANDROID_BITMAP_H
+
+#include <cstdint>
+
+// Stands in for the NDK header on the host, with the parts BlurManager.h uses.
+enum {
+    ANDROID_BITMAP_RESULT_SUCCESS = 0
+};
+
+enum AndroidBitmapFormat {
+    ANDROID_BITMAP_FORMAT_RGBA_8888 = 1,
+    ANDROID_BITMAP_FORMAT_RGB_565 = 4
+};
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    int32_t format;
+    uint32_t flags;
+} AndroidBitmapInfo;
+
+#endif //TESTBED_HOST_ANDROID_BITMAP_H
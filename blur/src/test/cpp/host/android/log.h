@@ -0,0 +1,14 @@
+#ifndef TESTBED_HOST_ANDROID_LOG_H
+#define TESTBED_HOST_ANDROID_LOG_H
+
+// Stands in for the NDK header on the host, the logs of the code under test are dropped.
+enum {
+    ANDROID_LOG_VERBOSE = 2,
+    ANDROID_LOG_INFO = 4,
+    ANDROID_LOG_WARN = 5,
+    ANDROID_LOG_ERROR = 6
+};
+
+inline int __android_log_print(int, const char *, const char *, ...) { return 0; }
+
+#endif //TESTBED_HOST_ANDROID_LOG_H
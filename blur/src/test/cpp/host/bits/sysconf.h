@@ -0,0 +1,7 @@
+#ifndef TESTBED_HOST_BITS_SYSCONF_H
+#define TESTBED_HOST_BITS_SYSCONF_H
+
+// Bionic declares sysconf here, glibc in unistd.h.
+#include <unistd.h>
+
+#endif //TESTBED_HOST_BITS_SYSCONF_H
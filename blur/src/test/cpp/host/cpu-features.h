@@ -0,0 +1,27 @@
+#ifndef TESTBED_HOST_CPU_FEATURES_H
+#define TESTBED_HOST_CPU_FEATURES_H
+
+#include <cstdint>
+
+// Stands in for the NDK's cpufeatures on the x86-64 hosts the toolkit tests run on, which all have
+// SSSE3, so that the x86 kernels are exercised.
+typedef enum {
+    ANDROID_CPU_FAMILY_UNKNOWN = 0,
+    ANDROID_CPU_FAMILY_ARM,
+    ANDROID_CPU_FAMILY_X86,
+    ANDROID_CPU_FAMILY_MIPS,
+    ANDROID_CPU_FAMILY_ARM64,
+    ANDROID_CPU_FAMILY_X86_64
+} AndroidCpuFamily;
+
+enum {
+    ANDROID_CPU_ARM_FEATURE_NEON = 1 << 2,
+    ANDROID_CPU_ARM64_FEATURE_ASIMD = 1 << 1,
+    ANDROID_CPU_X86_FEATURE_SSSE3 = 1 << 0
+};
+
+inline AndroidCpuFamily android_getCpuFamily() { return ANDROID_CPU_FAMILY_X86_64; }
+
+inline uint64_t android_getCpuFeatures() { return ANDROID_CPU_X86_FEATURE_SSSE3; }
+
+#endif //TESTBED_HOST_CPU_FEATURES_H